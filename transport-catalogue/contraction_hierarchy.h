@@ -0,0 +1,552 @@
+#pragma once
+#include "graph.h"
+#include "router_engine.h"
+#include "search_space.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <optional>
+#include <stdexcept>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+namespace graph {
+
+    // Иерархия сжатия (contraction hierarchy). Вершины графа сжимаются по очереди,
+    // а вместо удаляемых путей добавляются рёбра-сокращения. Маршрут ищется двумя
+    // встречными поисками, которые идут только в вершины большего ранга.
+    template <typename Weight>
+    class ContractionHierarchy : public RouterEngine<Weight> {
+    private:
+        using Graph = DirectedWeightedGraph<Weight>;
+
+    public:
+        using typename RouterEngine<Weight>::RouteInfo;
+
+        // Ребро иерархии: исходное ребро графа либо сокращение из двух рёбер иерархии
+        struct HierarchyEdge {
+            VertexId from;
+            VertexId to;
+            Weight weight;
+            EdgeId first;// id исходного ребра графа или первой половины сокращения
+            std::optional<EdgeId> second;// вторая половина сокращения
+        };
+
+        struct HierarchyData {
+            std::vector<size_t> ranks;
+            std::vector<HierarchyEdge> edges;
+        };
+
+        explicit ContractionHierarchy(const Graph& graph);
+
+        ContractionHierarchy(const Graph& graph, HierarchyData hierarchy_data);
+
+        std::optional<RouteInfo> BuildRoute(VertexId from, VertexId to) const override;
+
+        std::optional<Weight> ComputeRouteWeight(VertexId from, VertexId to) const override;
+
+        const HierarchyData& GetData() const;
+
+        // Отдаёт иерархию без копирования; после этого иерархию можно только разрушить
+        HierarchyData ReleaseData();
+
+        // Вызывает func(edge_id, edge) для рёбер иерархии из vertex в вершины большего ранга
+        template <typename Func>
+        void ForEachUpwardEdge(VertexId vertex, Func func) const;
+
+        // Вызывает func(edge_id, edge) для рёбер иерархии в vertex из вершин большего ранга
+        template <typename Func>
+        void ForEachDownwardEdge(VertexId vertex, Func func) const;
+
+        // Дописывает в edges рёбра графа, из которых состоит ребро иерархии
+        void UnpackEdge(EdgeId hierarchy_edge_id, std::vector<EdgeId>& edges) const;
+
+    private:
+        using Workspace = detail::Workspace<Weight>;
+        using SearchState = detail::SearchState<Weight>;
+        static constexpr EdgeId NO_EDGE = detail::NO_EDGE;
+
+        class Contractor;
+
+        void BuildSearchGraphs();
+
+        // Встречный поиск по иерархии; возвращает вес маршрута и вершину, в которой встретились поиски
+        std::optional<std::pair<Weight, VertexId>> Search(VertexId from, VertexId to,
+            SearchState& forward, SearchState& backward) const;
+
+        static constexpr Weight ZERO_WEIGHT{};
+        const Graph& graph_;
+        HierarchyData data_;
+        // Рёбра к вершинам большего ранга: для прямого поиска хранятся у начала ребра,
+        // для обратного - у конца
+        std::vector<size_t> upward_offsets_;
+        std::vector<EdgeId> upward_edges_;
+        std::vector<size_t> downward_offsets_;
+        std::vector<EdgeId> downward_edges_;
+    };
+
+    // Сжимает вершины графа в порядке, который выбирается по числу добавляемых сокращений
+    template <typename Weight>
+    class ContractionHierarchy<Weight>::Contractor {
+    public:
+        explicit Contractor(const Graph& graph)
+            : vertex_count_(graph.GetVertexCount())
+            , out_(vertex_count_)
+            , in_(vertex_count_)
+            , contracted_(vertex_count_, false)
+            , contracted_neighbours_(vertex_count_, 0)
+            , priorities_(vertex_count_, 0)
+        {
+            // Из параллельных рёбер в иерархию попадает самое лёгкое, а при равенстве - добавленное первым
+            std::vector<std::tuple<VertexId, Weight, EdgeId>> outgoing;
+            for (VertexId vertex = 0; vertex < vertex_count_; ++vertex) {
+                outgoing.clear();
+                for (const EdgeId edge_id : graph.GetIncidentEdges(vertex)) {
+                    const auto& edge = graph.GetEdge(edge_id);
+                    if (edge.weight < ZERO_WEIGHT) {
+                        throw std::domain_error("Edges' weights should be non-negative");
+                    }
+                    if (edge.to != vertex) {
+                        outgoing.emplace_back(edge.to, edge.weight, edge_id);
+                    }
+                }
+                std::sort(outgoing.begin(), outgoing.end());
+                for (size_t i = 0; i < outgoing.size(); ++i) {
+                    const auto& [to, weight, edge_id] = outgoing[i];
+                    if (i == 0 || std::get<0>(outgoing[i - 1]) != to) {
+                        AddArc(HierarchyEdge{ vertex, to, weight, edge_id, std::nullopt });
+                    }
+                }
+            }
+        }
+
+        HierarchyData Contract() {
+            HierarchyData result;
+            result.ranks.assign(vertex_count_, 0);
+            is_search_edge_.assign(edges_.size(), false);
+
+            using QueueItem = std::pair<int64_t, VertexId>;
+            std::vector<QueueItem> queue;
+            for (VertexId vertex = 0; vertex < vertex_count_; ++vertex) {
+                priorities_[vertex] = ComputePriority(vertex);
+                queue.emplace_back(priorities_[vertex], vertex);
+            }
+            std::make_heap(queue.begin(), queue.end(), std::greater<>{});
+
+            size_t rank = 0;
+            while (!queue.empty()) {
+                std::pop_heap(queue.begin(), queue.end(), std::greater<>{});
+                const auto [priority, vertex] = queue.back();
+                queue.pop_back();
+                if (contracted_[vertex] || priority != priorities_[vertex]) {
+                    continue;
+                }
+                // Ленивое обновление: приоритет мог вырасти после сжатия соседей
+                const int64_t actual_priority = ComputePriority(vertex);
+                if (actual_priority > priority && !queue.empty() && actual_priority > queue.front().first) {
+                    priorities_[vertex] = actual_priority;
+                    queue.emplace_back(actual_priority, vertex);
+                    std::push_heap(queue.begin(), queue.end(), std::greater<>{});
+                    continue;
+                }
+                result.ranks[vertex] = rank++;
+                ContractVertex(vertex);
+            }
+
+            // В результат попадают только рёбра, по которым идёт поиск; половины сокращений
+            // всегда среди них, так как сокращение строится из рёбер сжимаемой вершины
+            std::vector<EdgeId> new_ids(edges_.size(), NO_EDGE);
+            for (EdgeId edge_id = 0; edge_id < edges_.size(); ++edge_id) {
+                if (is_search_edge_[edge_id]) {
+                    new_ids[edge_id] = result.edges.size();
+                    result.edges.push_back(edges_[edge_id]);
+                }
+            }
+            for (auto& edge : result.edges) {
+                if (edge.second) {
+                    edge.first = new_ids[edge.first];
+                    edge.second = new_ids[*edge.second];
+                }
+            }
+            return result;
+        }
+
+    private:
+        struct Arc {
+            VertexId vertex;
+            EdgeId edge;
+        };
+
+        struct Shortcut {
+            VertexId from;
+            VertexId to;
+            Weight weight;
+            EdgeId first;
+            EdgeId second;
+        };
+
+        static constexpr size_t WITNESS_SEARCH_LIMIT = 64;
+
+        void AddArc(const HierarchyEdge& edge) {
+            const EdgeId edge_id = edges_.size();
+            edges_.push_back(edge);
+            out_[edge.from].push_back(Arc{ edge.to, edge_id });
+            in_[edge.to].push_back(Arc{ edge.from, edge_id });
+        }
+
+        void AddShortcut(const Shortcut& shortcut) {
+            const HierarchyEdge edge{ shortcut.from, shortcut.to, shortcut.weight, shortcut.first, shortcut.second };
+            auto it = std::find_if(out_[shortcut.from].begin(), out_[shortcut.from].end(), [&shortcut](const Arc& arc) {
+                return arc.vertex == shortcut.to;
+                });
+            if (it == out_[shortcut.from].end()) {
+                AddArc(edge);
+                is_search_edge_.push_back(false);
+                return;
+            }
+            if (!(shortcut.weight < edges_[it->edge].weight)) {
+                return;
+            }
+            // Сокращение заменяет более тяжёлое ребро между теми же вершинами
+            const EdgeId edge_id = edges_.size();
+            edges_.push_back(edge);
+            is_search_edge_.push_back(false);
+            auto in_it = std::find_if(in_[shortcut.to].begin(), in_[shortcut.to].end(), [&shortcut](const Arc& arc) {
+                return arc.vertex == shortcut.from;
+                });
+            it->edge = edge_id;
+            in_it->edge = edge_id;
+        }
+
+        // Ищет пути из source в соседей вершины via в обход неё, не длиннее max_weight
+        void RunWitnessSearch(VertexId source, VertexId via, Weight max_weight) {
+            const uint32_t generation = workspace_.Start(vertex_count_);
+            if (target_marks_.size() < vertex_count_) {
+                target_marks_.resize(vertex_count_, 0);
+            }
+            size_t targets_left = 0;
+            for (const Arc& arc : out_[via]) {
+                if (arc.vertex != source && target_marks_[arc.vertex] != generation) {
+                    target_marks_[arc.vertex] = generation;
+                    ++targets_left;
+                }
+            }
+            SearchState state(workspace_.forward, generation);
+            state.Relax(source, ZERO_WEIGHT, NO_EDGE);
+            size_t settled_count = 0;
+            while (targets_left > 0 && state.SkipSettled() && !(max_weight < state.TopWeight())
+                && settled_count < WITNESS_SEARCH_LIMIT) {
+                const VertexId vertex = state.SettleTop();
+                ++settled_count;
+                if (target_marks_[vertex] == generation) {
+                    --targets_left;
+                }
+                const Weight weight = state.GetWeight(vertex);
+                for (const Arc& arc : out_[vertex]) {
+                    if (arc.vertex != via) {
+                        state.Relax(arc.vertex, weight + edges_[arc.edge].weight, arc.edge);
+                    }
+                }
+            }
+        }
+
+        template <typename Callback>
+        void ForEachShortcut(VertexId vertex, Callback callback) {
+            for (const Arc& in_arc : in_[vertex]) {
+                const Weight in_weight = edges_[in_arc.edge].weight;
+                std::optional<Weight> max_weight;
+                for (const Arc& out_arc : out_[vertex]) {
+                    if (out_arc.vertex != in_arc.vertex) {
+                        const Weight weight = in_weight + edges_[out_arc.edge].weight;
+                        if (!max_weight || *max_weight < weight) {
+                            max_weight = weight;
+                        }
+                    }
+                }
+                if (!max_weight) {
+                    continue;
+                }
+                RunWitnessSearch(in_arc.vertex, vertex, *max_weight);
+                SearchState state(workspace_.forward, workspace_.generation);
+                for (const Arc& out_arc : out_[vertex]) {
+                    if (out_arc.vertex == in_arc.vertex) {
+                        continue;
+                    }
+                    const Weight weight = in_weight + edges_[out_arc.edge].weight;
+                    if (state.IsReached(out_arc.vertex) && !(weight < state.GetWeight(out_arc.vertex))) {
+                        continue;
+                    }
+                    callback(Shortcut{ in_arc.vertex, out_arc.vertex, weight, in_arc.edge, out_arc.edge });
+                }
+            }
+        }
+
+        int64_t ComputePriority(VertexId vertex) {
+            int64_t shortcut_count = 0;
+            ForEachShortcut(vertex, [&shortcut_count](const Shortcut&) {
+                ++shortcut_count;
+                });
+            const int64_t degree = static_cast<int64_t>(in_[vertex].size() + out_[vertex].size());
+            return shortcut_count - degree + static_cast<int64_t>(contracted_neighbours_[vertex]);
+        }
+
+        // Сжимает вершину и возвращает её ещё не сжатых соседей
+        std::vector<VertexId> ContractVertex(VertexId vertex) {
+            std::vector<Shortcut> shortcuts;
+            ForEachShortcut(vertex, [&shortcuts](const Shortcut& shortcut) {
+                shortcuts.push_back(shortcut);
+                });
+
+            contracted_[vertex] = true;
+            std::vector<VertexId> neighbours;
+            for (const Arc& arc : out_[vertex]) {
+                is_search_edge_[arc.edge] = true;
+                auto& arcs = in_[arc.vertex];
+                arcs.erase(std::remove_if(arcs.begin(), arcs.end(), [vertex](const Arc& other) {
+                    return other.vertex == vertex;
+                    }), arcs.end());
+                neighbours.push_back(arc.vertex);
+            }
+            for (const Arc& arc : in_[vertex]) {
+                is_search_edge_[arc.edge] = true;
+                auto& arcs = out_[arc.vertex];
+                arcs.erase(std::remove_if(arcs.begin(), arcs.end(), [vertex](const Arc& other) {
+                    return other.vertex == vertex;
+                    }), arcs.end());
+                neighbours.push_back(arc.vertex);
+            }
+            out_[vertex].clear();
+            in_[vertex].clear();
+
+            for (const Shortcut& shortcut : shortcuts) {
+                AddShortcut(shortcut);
+            }
+
+            std::sort(neighbours.begin(), neighbours.end());
+            neighbours.erase(std::unique(neighbours.begin(), neighbours.end()), neighbours.end());
+            for (const VertexId neighbour : neighbours) {
+                ++contracted_neighbours_[neighbour];
+            }
+            return neighbours;
+        }
+
+        size_t vertex_count_;
+        std::vector<HierarchyEdge> edges_;
+        std::vector<bool> is_search_edge_;
+        std::vector<std::vector<Arc>> out_;
+        std::vector<std::vector<Arc>> in_;
+        std::vector<bool> contracted_;
+        std::vector<size_t> contracted_neighbours_;
+        std::vector<int64_t> priorities_;
+        std::vector<uint32_t> target_marks_;
+        Workspace workspace_;
+    };
+
+    template <typename Weight>
+    ContractionHierarchy<Weight>::ContractionHierarchy(const Graph& graph)
+        : graph_(graph)
+        , data_(Contractor(graph).Contract())
+    {
+        BuildSearchGraphs();
+    }
+
+    template <typename Weight>
+    ContractionHierarchy<Weight>::ContractionHierarchy(const Graph& graph, HierarchyData hierarchy_data)
+        : graph_(graph)
+        , data_(std::move(hierarchy_data))
+    {
+        if (data_.ranks.size() != graph_.GetVertexCount()) {
+            throw std::invalid_argument("Contraction hierarchy does not match the graph");
+        }
+        BuildSearchGraphs();
+    }
+
+    template <typename Weight>
+    void ContractionHierarchy<Weight>::BuildSearchGraphs() {
+        const size_t vertex_count = graph_.GetVertexCount();
+        upward_offsets_.assign(vertex_count + 1, 0);
+        downward_offsets_.assign(vertex_count + 1, 0);
+        for (const auto& edge : data_.edges) {
+            if (data_.ranks[edge.from] < data_.ranks[edge.to]) {
+                ++upward_offsets_[edge.from + 1];
+            }
+            else {
+                ++downward_offsets_[edge.to + 1];
+            }
+        }
+        for (VertexId vertex = 0; vertex < vertex_count; ++vertex) {
+            upward_offsets_[vertex + 1] += upward_offsets_[vertex];
+            downward_offsets_[vertex + 1] += downward_offsets_[vertex];
+        }
+        upward_edges_.resize(upward_offsets_.back());
+        downward_edges_.resize(downward_offsets_.back());
+        std::vector<size_t> upward_positions(upward_offsets_.begin(), std::prev(upward_offsets_.end()));
+        std::vector<size_t> downward_positions(downward_offsets_.begin(), std::prev(downward_offsets_.end()));
+        for (EdgeId edge_id = 0; edge_id < data_.edges.size(); ++edge_id) {
+            const auto& edge = data_.edges[edge_id];
+            if (data_.ranks[edge.from] < data_.ranks[edge.to]) {
+                upward_edges_[upward_positions[edge.from]++] = edge_id;
+            }
+            else {
+                downward_edges_[downward_positions[edge.to]++] = edge_id;
+            }
+        }
+    }
+
+    template <typename Weight>
+    std::optional<typename ContractionHierarchy<Weight>::RouteInfo> ContractionHierarchy<Weight>::BuildRoute(VertexId from,
+        VertexId to) const {
+        const size_t vertex_count = graph_.GetVertexCount();
+        if (from >= vertex_count || to >= vertex_count) {
+            throw std::out_of_range("Vertex id is out of range");
+        }
+        if (from == to) {
+            return RouteInfo{ ZERO_WEIGHT, {} };
+        }
+        Workspace& workspace = detail::GetThreadWorkspace<Weight>();
+        const uint32_t generation = workspace.Start(vertex_count);
+        SearchState forward(workspace.forward, generation);
+        SearchState backward(workspace.backward, generation);
+        const auto search_result = Search(from, to, forward, backward);
+        if (!search_result) {
+            return std::nullopt;
+        }
+        const VertexId meeting_vertex = search_result->second;
+
+        std::vector<EdgeId> hierarchy_edges;
+        for (EdgeId edge_id = forward.GetPrevEdge(meeting_vertex); edge_id != NO_EDGE;
+            edge_id = forward.GetPrevEdge(data_.edges[edge_id].from)) {
+            hierarchy_edges.push_back(edge_id);
+        }
+        std::reverse(hierarchy_edges.begin(), hierarchy_edges.end());
+        for (EdgeId edge_id = backward.GetPrevEdge(meeting_vertex); edge_id != NO_EDGE;
+            edge_id = backward.GetPrevEdge(data_.edges[edge_id].to)) {
+            hierarchy_edges.push_back(edge_id);
+        }
+
+        std::vector<EdgeId> edges;
+        for (const EdgeId edge_id : hierarchy_edges) {
+            UnpackEdge(edge_id, edges);
+        }
+        return RouteInfo{ search_result->first, std::move(edges) };
+    }
+
+    template <typename Weight>
+    std::optional<Weight> ContractionHierarchy<Weight>::ComputeRouteWeight(VertexId from, VertexId to) const {
+        const size_t vertex_count = graph_.GetVertexCount();
+        if (from >= vertex_count || to >= vertex_count) {
+            throw std::out_of_range("Vertex id is out of range");
+        }
+        if (from == to) {
+            return ZERO_WEIGHT;
+        }
+        Workspace& workspace = detail::GetThreadWorkspace<Weight>();
+        const uint32_t generation = workspace.Start(vertex_count);
+        SearchState forward(workspace.forward, generation);
+        SearchState backward(workspace.backward, generation);
+        if (const auto search_result = Search(from, to, forward, backward)) {
+            return search_result->first;
+        }
+        return std::nullopt;
+    }
+
+    template <typename Weight>
+    std::optional<std::pair<Weight, VertexId>> ContractionHierarchy<Weight>::Search(VertexId from, VertexId to,
+        SearchState& forward, SearchState& backward) const {
+        forward.Relax(from, ZERO_WEIGHT, NO_EDGE);
+        backward.Relax(to, ZERO_WEIGHT, NO_EDGE);
+
+        std::optional<Weight> best_weight;
+        VertexId meeting_vertex = from;
+        auto update_best = [&](VertexId vertex) {
+            if (forward.IsReached(vertex) && backward.IsReached(vertex)) {
+                const Weight candidate = forward.GetWeight(vertex) + backward.GetWeight(vertex);
+                if (!best_weight || candidate < *best_weight) {
+                    best_weight = candidate;
+                    meeting_vertex = vertex;
+                }
+            }
+        };
+        // Поиск в направлении продолжается, пока он может улучшить найденный маршрут
+        auto is_active = [&best_weight](SearchState& state) {
+            return state.SkipSettled() && (!best_weight || state.TopWeight() < *best_weight);
+        };
+
+        while (true) {
+            const bool forward_active = is_active(forward);
+            const bool backward_active = is_active(backward);
+            if (!forward_active && !backward_active) {
+                break;
+            }
+            if (forward_active && (!backward_active || !(backward.TopWeight() < forward.TopWeight()))) {
+                const VertexId vertex = forward.SettleTop();
+                const Weight weight = forward.GetWeight(vertex);
+                for (size_t i = upward_offsets_[vertex]; i < upward_offsets_[vertex + 1]; ++i) {
+                    const auto& edge = data_.edges[upward_edges_[i]];
+                    if (forward.Relax(edge.to, weight + edge.weight, upward_edges_[i])) {
+                        update_best(edge.to);
+                    }
+                }
+            }
+            else {
+                const VertexId vertex = backward.SettleTop();
+                const Weight weight = backward.GetWeight(vertex);
+                for (size_t i = downward_offsets_[vertex]; i < downward_offsets_[vertex + 1]; ++i) {
+                    const auto& edge = data_.edges[downward_edges_[i]];
+                    if (backward.Relax(edge.from, weight + edge.weight, downward_edges_[i])) {
+                        update_best(edge.from);
+                    }
+                }
+            }
+        }
+        if (!best_weight) {
+            return std::nullopt;
+        }
+        return std::pair{ *best_weight, meeting_vertex };
+    }
+
+    template <typename Weight>
+    void ContractionHierarchy<Weight>::UnpackEdge(EdgeId hierarchy_edge_id, std::vector<EdgeId>& edges) const {
+        std::vector<EdgeId> stack{ hierarchy_edge_id };
+        while (!stack.empty()) {
+            const auto& edge = data_.edges[stack.back()];
+            stack.pop_back();
+            if (edge.second) {
+                stack.push_back(*edge.second);
+                stack.push_back(edge.first);
+            }
+            else {
+                edges.push_back(edge.first);
+            }
+        }
+    }
+
+    template <typename Weight>
+    const typename ContractionHierarchy<Weight>::HierarchyData& ContractionHierarchy<Weight>::GetData() const {
+        return data_;
+    }
+
+    template <typename Weight>
+    typename ContractionHierarchy<Weight>::HierarchyData ContractionHierarchy<Weight>::ReleaseData() {
+        return std::move(data_);
+    }
+
+    template <typename Weight>
+    template <typename Func>
+    void ContractionHierarchy<Weight>::ForEachUpwardEdge(VertexId vertex, Func func) const {
+        for (size_t i = upward_offsets_[vertex]; i < upward_offsets_[vertex + 1]; ++i) {
+            func(upward_edges_[i], data_.edges[upward_edges_[i]]);
+        }
+    }
+
+    template <typename Weight>
+    template <typename Func>
+    void ContractionHierarchy<Weight>::ForEachDownwardEdge(VertexId vertex, Func func) const {
+        for (size_t i = downward_offsets_[vertex]; i < downward_offsets_[vertex + 1]; ++i) {
+            func(downward_edges_[i], data_.edges[downward_edges_[i]]);
+        }
+    }
+
+}  // namespace graph
@@ -0,0 +1,485 @@
+#pragma once
+#include "graph.h"
+#include "router_engine.h"
+#include "search_space.h"
+#include "thread_pool.h"
+
+#include <algorithm>
+#include <functional>
+#include <iterator>
+#include <limits>
+#include <optional>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+namespace graph {
+
+    // Настраиваемая иерархия сжатия (customizable contraction hierarchy). Порядок вершин и рёбра иерархии
+    // зависят только от структуры графа: вершины исключаются по очереди, а их соседи попарно соединяются.
+    // Веса рёбер иерархии рассчитываются отдельным быстрым шагом настройки, поэтому при изменении весов графа
+    // порядок переиспользуется. Ребро с бесконечным весом считается отсутствующим.
+    template <typename Weight>
+    class CustomizableContractionHierarchy : public RouterEngine<Weight> {
+    private:
+        using Graph = DirectedWeightedGraph<Weight>;
+
+    public:
+        using typename RouterEngine<Weight>::RouteInfo;
+
+        // Порядок вершин выбирается по наименьшей степени; thread_count == 0 означает число аппаратных потоков
+        explicit CustomizableContractionHierarchy(const Graph& graph, size_t thread_count = 1);
+
+        // Готовый порядок вершин, например порядок графа с той же структурой и прежними весами
+        CustomizableContractionHierarchy(const Graph& graph, std::vector<size_t> ranks, size_t thread_count = 1);
+
+        std::optional<RouteInfo> BuildRoute(VertexId from, VertexId to) const override;
+
+        std::optional<Weight> ComputeRouteWeight(VertexId from, VertexId to) const override;
+
+        const std::vector<size_t>& GetRanks() const;
+
+    private:
+        static constexpr VertexId NO_VERTEX = std::numeric_limits<VertexId>::max();
+        static constexpr EdgeId NO_EDGE = detail::NO_EDGE;
+        static constexpr Weight ZERO_WEIGHT{};
+        static constexpr Weight UNREACHABLE_WEIGHT = std::numeric_limits<Weight>::has_infinity
+            ? std::numeric_limits<Weight>::infinity() : std::numeric_limits<Weight>::max();
+
+        // Откуда взят вес направления ребра иерархии: исходное ребро графа либо путь через вершину меньшего ранга
+        struct ArcOrigin {
+            EdgeId edge = NO_EDGE;
+            VertexId middle = NO_VERTEX;
+        };
+
+        std::vector<std::vector<VertexId>> GetUndirectedNeighbours() const;
+
+        // Порядок наименьшей степени: исключается вершина с наименьшим числом соседей, а её соседи попарно соединяются
+        void ComputeOrder();
+
+        // Рёбра иерархии по порядку ranks_: соседи исключённой вершины большего ранга становятся концами её рёбер
+        void BuildArcs();
+
+        void Customize(size_t thread_count);
+
+        // Ребро иерархии между вершиной lower и её соседом upper большего ранга
+        size_t FindArc(VertexId lower, VertexId upper) const;
+
+        // Обновляет веса верхних концов рёбер иерархии вершины
+        void RelaxUpward(VertexId vertex, detail::SearchSpace<Weight>& space, uint32_t generation,
+            const std::vector<Weight>& arc_weights) const;
+
+        std::optional<std::pair<Weight, VertexId>> Search(VertexId from, VertexId to, detail::Workspace<Weight>& workspace,
+            uint32_t generation) const;
+
+        // Дописывает в edges рёбра графа направления ребра иерархии: вверх - от меньшего ранга к большему
+        void UnpackArc(size_t arc, bool is_upward, std::vector<EdgeId>& edges) const;
+
+        const Graph& graph_;
+        std::vector<size_t> ranks_;
+        std::vector<VertexId> parents_;// родитель в дереве исключения - сосед наименьшего большего ранга
+        // Рёбра иерархии вершины v занимают позиции [arc_offsets_[v], arc_offsets_[v + 1]), концы отсортированы по рангу
+        std::vector<size_t> arc_offsets_;
+        std::vector<VertexId> arc_sources_;
+        std::vector<VertexId> arc_targets_;
+        // Рёбра иерархии, которые входят в вершину из вершин меньшего ранга
+        std::vector<size_t> lower_arc_offsets_;
+        std::vector<size_t> lower_arcs_;
+        // Веса направлений рёбер вверх - от меньшего ранга к большему - и вниз
+        std::vector<Weight> upward_weights_;
+        std::vector<Weight> downward_weights_;
+        std::vector<ArcOrigin> upward_origins_;
+        std::vector<ArcOrigin> downward_origins_;
+    };
+
+    template <typename Weight>
+    CustomizableContractionHierarchy<Weight>::CustomizableContractionHierarchy(const Graph& graph, size_t thread_count)
+        : graph_(graph)
+    {
+        ComputeOrder();
+        BuildArcs();
+        Customize(thread_count);
+    }
+
+    template <typename Weight>
+    CustomizableContractionHierarchy<Weight>::CustomizableContractionHierarchy(const Graph& graph, std::vector<size_t> ranks,
+        size_t thread_count)
+        : graph_(graph)
+        , ranks_(std::move(ranks))
+    {
+        const size_t vertex_count = graph_.GetVertexCount();
+        std::vector<bool> is_used(vertex_count, false);
+        bool is_permutation = ranks_.size() == vertex_count;
+        for (size_t i = 0; i < ranks_.size() && is_permutation; ++i) {
+            is_permutation = ranks_[i] < vertex_count && !is_used[ranks_[i]];
+            if (is_permutation) {
+                is_used[ranks_[i]] = true;
+            }
+        }
+        if (!is_permutation) {
+            throw std::invalid_argument("Customizable contraction hierarchy does not match the graph");
+        }
+        BuildArcs();
+        Customize(thread_count);
+    }
+
+    template <typename Weight>
+    std::vector<std::vector<VertexId>> CustomizableContractionHierarchy<Weight>::GetUndirectedNeighbours() const {
+        std::vector<std::vector<VertexId>> neighbours(graph_.GetVertexCount());
+        for (const auto& edge : graph_.GetEdges()) {
+            if (edge.from != edge.to) {
+                neighbours[edge.from].push_back(edge.to);
+                neighbours[edge.to].push_back(edge.from);
+            }
+        }
+        for (auto& vertex_neighbours : neighbours) {
+            std::sort(vertex_neighbours.begin(), vertex_neighbours.end());
+            vertex_neighbours.erase(std::unique(vertex_neighbours.begin(), vertex_neighbours.end()), vertex_neighbours.end());
+        }
+        return neighbours;
+    }
+
+    template <typename Weight>
+    void CustomizableContractionHierarchy<Weight>::ComputeOrder() {
+        const size_t vertex_count = graph_.GetVertexCount();
+        // У исключённых вершин список соседей очищается, а их соседи попарно соединяются
+        std::vector<std::vector<VertexId>> neighbours = GetUndirectedNeighbours();
+        std::vector<std::pair<size_t, VertexId>> queue;
+        for (VertexId vertex = 0; vertex < vertex_count; ++vertex) {
+            queue.emplace_back(neighbours[vertex].size(), vertex);
+        }
+        std::make_heap(queue.begin(), queue.end(), std::greater<>{});
+
+        ranks_.assign(vertex_count, 0);
+        std::vector<bool> is_contracted(vertex_count, false);
+        std::vector<VertexId> merged;
+        for (size_t rank = 0; rank < vertex_count; ++rank) {
+            // В куче остаются устаревшие записи вершин, степень которых с тех пор изменилась
+            VertexId vertex = 0;
+            while (true) {
+                std::pop_heap(queue.begin(), queue.end(), std::greater<>{});
+                const auto [degree, candidate] = queue.back();
+                queue.pop_back();
+                if (!is_contracted[candidate] && degree == neighbours[candidate].size()) {
+                    vertex = candidate;
+                    break;
+                }
+            }
+            ranks_[vertex] = rank;
+            is_contracted[vertex] = true;
+            const std::vector<VertexId> clique = std::move(neighbours[vertex]);
+            neighbours[vertex] = {};
+            for (const VertexId neighbour : clique) {
+                merged.clear();
+                std::set_union(neighbours[neighbour].begin(), neighbours[neighbour].end(), clique.begin(), clique.end(),
+                    std::back_inserter(merged));
+                merged.erase(std::remove_if(merged.begin(), merged.end(), [vertex, neighbour](VertexId other) {
+                    return other == vertex || other == neighbour;
+                }), merged.end());
+                neighbours[neighbour].swap(merged);
+                queue.emplace_back(neighbours[neighbour].size(), neighbour);
+                std::push_heap(queue.begin(), queue.end(), std::greater<>{});
+            }
+        }
+    }
+
+    template <typename Weight>
+    void CustomizableContractionHierarchy<Weight>::BuildArcs() {
+        const size_t vertex_count = graph_.GetVertexCount();
+        std::vector<VertexId> order(vertex_count);
+        for (VertexId vertex = 0; vertex < vertex_count; ++vertex) {
+            order[ranks_[vertex]] = vertex;
+        }
+
+        // Соседи большего ранга у вершины - её соседи в графе и соседи её детей в дереве исключения,
+        // кроме неё самой. Дети исключаются раньше родителя, поэтому их списки уже готовы
+        std::vector<std::vector<VertexId>> upper_neighbours = GetUndirectedNeighbours();
+        std::vector<std::vector<VertexId>> children(vertex_count);
+        std::vector<VertexId> marks(vertex_count, NO_VERTEX);
+        parents_.assign(vertex_count, NO_VERTEX);
+        for (const VertexId vertex : order) {
+            std::vector<VertexId>& neighbours = upper_neighbours[vertex];
+            neighbours.erase(std::remove_if(neighbours.begin(), neighbours.end(), [&](VertexId neighbour) {
+                return ranks_[neighbour] < ranks_[vertex];
+            }), neighbours.end());
+            for (const VertexId neighbour : neighbours) {
+                marks[neighbour] = vertex;
+            }
+            for (const VertexId child : children[vertex]) {
+                for (const VertexId neighbour : upper_neighbours[child]) {
+                    if (neighbour != vertex && marks[neighbour] != vertex) {
+                        marks[neighbour] = vertex;
+                        neighbours.push_back(neighbour);
+                    }
+                }
+            }
+            std::sort(neighbours.begin(), neighbours.end(), [this](VertexId lhs, VertexId rhs) {
+                return ranks_[lhs] < ranks_[rhs];
+            });
+            if (!neighbours.empty()) {
+                parents_[vertex] = neighbours.front();
+                children[parents_[vertex]].push_back(vertex);
+            }
+        }
+
+        arc_offsets_.assign(vertex_count + 1, 0);
+        lower_arc_offsets_.assign(vertex_count + 1, 0);
+        for (VertexId vertex = 0; vertex < vertex_count; ++vertex) {
+            arc_offsets_[vertex + 1] = arc_offsets_[vertex] + upper_neighbours[vertex].size();
+            for (const VertexId neighbour : upper_neighbours[vertex]) {
+                ++lower_arc_offsets_[neighbour + 1];
+            }
+        }
+        for (VertexId vertex = 0; vertex < vertex_count; ++vertex) {
+            lower_arc_offsets_[vertex + 1] += lower_arc_offsets_[vertex];
+        }
+        arc_sources_.reserve(arc_offsets_.back());
+        arc_targets_.reserve(arc_offsets_.back());
+        lower_arcs_.resize(arc_offsets_.back());
+        std::vector<size_t> lower_positions(lower_arc_offsets_.begin(), std::prev(lower_arc_offsets_.end()));
+        for (VertexId vertex = 0; vertex < vertex_count; ++vertex) {
+            for (const VertexId neighbour : upper_neighbours[vertex]) {
+                lower_arcs_[lower_positions[neighbour]++] = arc_targets_.size();
+                arc_sources_.push_back(vertex);
+                arc_targets_.push_back(neighbour);
+            }
+            upper_neighbours[vertex] = {};
+        }
+    }
+
+    template <typename Weight>
+    void CustomizableContractionHierarchy<Weight>::Customize(size_t thread_count) {
+        const size_t vertex_count = graph_.GetVertexCount();
+        const size_t arc_count = arc_targets_.size();
+        upward_weights_.assign(arc_count, UNREACHABLE_WEIGHT);
+        downward_weights_.assign(arc_count, UNREACHABLE_WEIGHT);
+        upward_origins_.assign(arc_count, ArcOrigin{});
+        downward_origins_.assign(arc_count, ArcOrigin{});
+        // Из параллельных рёбер берётся самое лёгкое, а при равенстве - добавленное первым
+        for (EdgeId edge_id = 0; edge_id < graph_.GetEdgeCount(); ++edge_id) {
+            const auto& edge = graph_.GetEdge(edge_id);
+            if (edge.weight < ZERO_WEIGHT) {
+                throw std::domain_error("Edges' weights should be non-negative");
+            }
+            if (edge.from == edge.to) {
+                continue;
+            }
+            const bool is_upward = ranks_[edge.from] < ranks_[edge.to];
+            const size_t arc = is_upward ? FindArc(edge.from, edge.to) : FindArc(edge.to, edge.from);
+            Weight& weight = is_upward ? upward_weights_[arc] : downward_weights_[arc];
+            if (edge.weight < weight) {
+                weight = edge.weight;
+                (is_upward ? upward_origins_ : downward_origins_)[arc] = ArcOrigin{ edge_id, NO_VERTEX };
+            }
+        }
+
+        // Веса рёбер вершины уточняются по треугольникам с вершинами меньшего ранга, рёбра которых уже настроены.
+        // Уровень вершины на единицу больше наибольшего уровня её соседей меньшего ранга, поэтому
+        // вершины одного уровня друг от друга не зависят и настраиваются параллельно
+        std::vector<VertexId> order(vertex_count);
+        for (VertexId vertex = 0; vertex < vertex_count; ++vertex) {
+            order[ranks_[vertex]] = vertex;
+        }
+        std::vector<size_t> levels(vertex_count, 0);
+        std::vector<std::vector<VertexId>> vertices_by_level;
+        for (const VertexId vertex : order) {
+            for (size_t i = lower_arc_offsets_[vertex]; i < lower_arc_offsets_[vertex + 1]; ++i) {
+                levels[vertex] = std::max(levels[vertex], levels[arc_sources_[lower_arcs_[i]]] + 1);
+            }
+            if (vertices_by_level.size() <= levels[vertex]) {
+                vertices_by_level.resize(levels[vertex] + 1);
+            }
+            vertices_by_level[levels[vertex]].push_back(vertex);
+        }
+
+        parallel::ThreadPool pool(thread_count);
+        for (const auto& level_vertices : vertices_by_level) {
+            pool.ParallelFor(level_vertices.size(), [&](size_t index) {
+                const VertexId vertex = level_vertices[index];
+                // Позиции рёбер вершины по их верхним концам; у каждого потока свой массив
+                static thread_local std::vector<size_t> arc_positions;
+                arc_positions.resize(std::max(arc_positions.size(), vertex_count));
+                for (size_t arc = arc_offsets_[vertex]; arc < arc_offsets_[vertex + 1]; ++arc) {
+                    arc_positions[arc_targets_[arc]] = arc;
+                }
+                for (size_t i = lower_arc_offsets_[vertex]; i < lower_arc_offsets_[vertex + 1]; ++i) {
+                    const size_t lower_arc = lower_arcs_[i];
+                    const VertexId middle = arc_sources_[lower_arc];
+                    const Weight to_middle_weight = downward_weights_[lower_arc];
+                    const Weight from_middle_weight = upward_weights_[lower_arc];
+                    // Рёбра middle отсортированы по рангу, поэтому за ребром в vertex идут рёбра в вершины большего ранга
+                    for (size_t other_arc = lower_arc + 1; other_arc < arc_offsets_[middle + 1]; ++other_arc) {
+                        const size_t arc = arc_positions[arc_targets_[other_arc]];
+                        const Weight upward_weight = AddWeights(to_middle_weight, upward_weights_[other_arc]);
+                        if (upward_weight < upward_weights_[arc]) {
+                            upward_weights_[arc] = upward_weight;
+                            upward_origins_[arc] = ArcOrigin{ NO_EDGE, middle };
+                        }
+                        const Weight downward_weight = AddWeights(downward_weights_[other_arc], from_middle_weight);
+                        if (downward_weight < downward_weights_[arc]) {
+                            downward_weights_[arc] = downward_weight;
+                            downward_origins_[arc] = ArcOrigin{ NO_EDGE, middle };
+                        }
+                    }
+                }
+            });
+        }
+    }
+
+    template <typename Weight>
+    size_t CustomizableContractionHierarchy<Weight>::FindArc(VertexId lower, VertexId upper) const {
+        const auto begin = arc_targets_.begin() + arc_offsets_[lower];
+        const auto end = arc_targets_.begin() + arc_offsets_[lower + 1];
+        const auto it = std::lower_bound(begin, end, upper, [this](VertexId lhs, VertexId rhs) {
+            return ranks_[lhs] < ranks_[rhs];
+        });
+        if (it == end || *it != upper) {
+            throw std::logic_error("Customizable contraction hierarchy is inconsistent");
+        }
+        return it - arc_targets_.begin();
+    }
+
+    template <typename Weight>
+    void CustomizableContractionHierarchy<Weight>::RelaxUpward(VertexId vertex, detail::SearchSpace<Weight>& space,
+        uint32_t generation, const std::vector<Weight>& arc_weights) const {
+        for (size_t arc = arc_offsets_[vertex]; arc < arc_offsets_[vertex + 1]; ++arc) {
+            const Weight weight = AddWeights(space.weights[vertex], arc_weights[arc]);
+            const VertexId upper = arc_targets_[arc];
+            if (weight < UNREACHABLE_WEIGHT && (space.reached[upper] != generation || weight < space.weights[upper])) {
+                space.reached[upper] = generation;
+                space.weights[upper] = weight;
+                space.prev_edges[upper] = arc;
+            }
+        }
+    }
+
+    template <typename Weight>
+    std::optional<std::pair<Weight, VertexId>> CustomizableContractionHierarchy<Weight>::Search(VertexId from, VertexId to,
+        detail::Workspace<Weight>& workspace, uint32_t generation) const {
+        detail::SearchSpace<Weight>& forward = workspace.forward;
+        detail::SearchSpace<Weight>& backward = workspace.backward;
+        for (auto [space, vertex] : { std::pair{ &forward, from }, std::pair{ &backward, to } }) {
+            space->reached[vertex] = generation;
+            space->weights[vertex] = ZERO_WEIGHT;
+            space->prev_edges[vertex] = NO_EDGE;
+        }
+
+        // Все вершины, достижимые вверх по иерархии, - предки начальной вершины в дереве исключения.
+        // Предки обеих вершин обходятся вместе по возрастанию ранга, поэтому к моменту обхода вершины её вес окончателен,
+        // а вершины, вес которых не меньше найденного маршрута, не продолжают поиск
+        std::optional<std::pair<Weight, VertexId>> best;
+        auto is_promising = [&](const detail::SearchSpace<Weight>& space, VertexId vertex) {
+            return space.reached[vertex] == generation && (!best || space.weights[vertex] < best->first);
+        };
+        VertexId forward_vertex = from;
+        VertexId backward_vertex = to;
+        while (forward_vertex != NO_VERTEX || backward_vertex != NO_VERTEX) {
+            const bool is_forward = forward_vertex != NO_VERTEX
+                && (backward_vertex == NO_VERTEX || ranks_[forward_vertex] <= ranks_[backward_vertex]);
+            const bool is_backward = backward_vertex != NO_VERTEX
+                && (forward_vertex == NO_VERTEX || ranks_[backward_vertex] <= ranks_[forward_vertex]);
+            if (is_forward && is_backward && forward.reached[forward_vertex] == generation
+                && backward.reached[forward_vertex] == generation) {
+                const Weight weight = forward.weights[forward_vertex] + backward.weights[forward_vertex];
+                if (!best || weight < best->first) {
+                    best = std::pair{ weight, forward_vertex };
+                }
+            }
+            if (is_forward) {
+                if (is_promising(forward, forward_vertex)) {
+                    RelaxUpward(forward_vertex, forward, generation, upward_weights_);
+                }
+                forward_vertex = parents_[forward_vertex];
+            }
+            if (is_backward) {
+                if (is_promising(backward, backward_vertex)) {
+                    RelaxUpward(backward_vertex, backward, generation, downward_weights_);
+                }
+                backward_vertex = parents_[backward_vertex];
+            }
+        }
+        return best;
+    }
+
+    template <typename Weight>
+    std::optional<typename CustomizableContractionHierarchy<Weight>::RouteInfo> CustomizableContractionHierarchy<Weight>::BuildRoute(
+        VertexId from, VertexId to) const {
+        const size_t vertex_count = graph_.GetVertexCount();
+        if (from >= vertex_count || to >= vertex_count) {
+            throw std::out_of_range("Vertex id is out of range");
+        }
+        if (from == to) {
+            return RouteInfo{ ZERO_WEIGHT, {} };
+        }
+        detail::Workspace<Weight>& workspace = detail::GetThreadWorkspace<Weight>();
+        const uint32_t generation = workspace.Start(vertex_count);
+        const auto search_result = Search(from, to, workspace, generation);
+        if (!search_result) {
+            return std::nullopt;
+        }
+        const VertexId meeting_vertex = search_result->second;
+
+        std::vector<size_t> forward_arcs;
+        for (VertexId vertex = meeting_vertex; workspace.forward.prev_edges[vertex] != NO_EDGE;
+            vertex = arc_sources_[workspace.forward.prev_edges[vertex]]) {
+            forward_arcs.push_back(workspace.forward.prev_edges[vertex]);
+        }
+        std::vector<EdgeId> edges;
+        for (auto it = forward_arcs.rbegin(); it != forward_arcs.rend(); ++it) {
+            UnpackArc(*it, true, edges);
+        }
+        for (VertexId vertex = meeting_vertex; workspace.backward.prev_edges[vertex] != NO_EDGE;
+            vertex = arc_sources_[workspace.backward.prev_edges[vertex]]) {
+            UnpackArc(workspace.backward.prev_edges[vertex], false, edges);
+        }
+        return RouteInfo{ search_result->first, std::move(edges) };
+    }
+
+    template <typename Weight>
+    std::optional<Weight> CustomizableContractionHierarchy<Weight>::ComputeRouteWeight(VertexId from, VertexId to) const {
+        const size_t vertex_count = graph_.GetVertexCount();
+        if (from >= vertex_count || to >= vertex_count) {
+            throw std::out_of_range("Vertex id is out of range");
+        }
+        if (from == to) {
+            return ZERO_WEIGHT;
+        }
+        detail::Workspace<Weight>& workspace = detail::GetThreadWorkspace<Weight>();
+        const uint32_t generation = workspace.Start(vertex_count);
+        if (const auto search_result = Search(from, to, workspace, generation)) {
+            return search_result->first;
+        }
+        return std::nullopt;
+    }
+
+    template <typename Weight>
+    void CustomizableContractionHierarchy<Weight>::UnpackArc(size_t arc, bool is_upward, std::vector<EdgeId>& edges) const {
+        std::vector<std::pair<size_t, bool>> stack{ { arc, is_upward } };
+        while (!stack.empty()) {
+            const auto [current_arc, current_is_upward] = stack.back();
+            stack.pop_back();
+            const ArcOrigin& origin = current_is_upward ? upward_origins_[current_arc] : downward_origins_[current_arc];
+            if (origin.edge != NO_EDGE) {
+                edges.push_back(origin.edge);
+                continue;
+            }
+            // Путь вверх идёт из нижнего конца в middle и дальше в верхний конец, путь вниз - в обратную сторону
+            const size_t lower_arc = FindArc(origin.middle, arc_sources_[current_arc]);
+            const size_t upper_arc = FindArc(origin.middle, arc_targets_[current_arc]);
+            if (current_is_upward) {
+                stack.emplace_back(upper_arc, true);
+                stack.emplace_back(lower_arc, false);
+            }
+            else {
+                stack.emplace_back(lower_arc, true);
+                stack.emplace_back(upper_arc, false);
+            }
+        }
+    }
+
+    template <typename Weight>
+    const std::vector<size_t>& CustomizableContractionHierarchy<Weight>::GetRanks() const {
+        return ranks_;
+    }
+
+}  // namespace graph
@@ -0,0 +1,212 @@
+#pragma once
+#include "graph.h"
+#include "router_engine.h"
+#include "search_space.h"
+
+#include <algorithm>
+#include <memory>
+#include <optional>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+namespace graph {
+
+    // Поиск маршрута по запросу алгоритмом Дейкстры без предварительного расчёта.
+    // Поиск останавливается, как только достигнута конечная вершина;
+    // в двунаправленном режиме навстречу ему ведётся поиск по обратным рёбрам.
+    template <typename Weight>
+    class DijkstraRouter : public RouterEngine<Weight> {
+    private:
+        using Graph = DirectedWeightedGraph<Weight>;
+
+    public:
+        using typename RouterEngine<Weight>::RouteInfo;
+
+        explicit DijkstraRouter(const Graph& graph, bool bidirectional = false);
+
+        std::optional<RouteInfo> BuildRoute(VertexId from, VertexId to) const override;
+
+        // Один поиск из from, который останавливается, когда достигнуты все вершины targets
+        std::vector<std::optional<Weight>> ComputeRouteWeights(VertexId from, const std::vector<VertexId>& targets) const override;
+
+    private:
+        using Workspace = detail::Workspace<Weight>;
+        using SearchState = detail::SearchState<Weight>;
+        static constexpr EdgeId NO_EDGE = detail::NO_EDGE;
+
+        std::optional<RouteInfo> BuildRouteForward(VertexId from, VertexId to, Workspace& workspace) const;
+
+        std::optional<RouteInfo> BuildRouteBidirectional(VertexId from, VertexId to, Workspace& workspace) const;
+
+        static constexpr Weight ZERO_WEIGHT{};
+        const Graph& graph_;
+        std::unique_ptr<Graph> reversed_graph_;
+    };
+
+    template <typename Weight>
+    DijkstraRouter<Weight>::DijkstraRouter(const Graph& graph, bool bidirectional)
+        : graph_(graph)
+    {
+        for (const auto& edge : graph.GetEdges()) {
+            if (edge.weight < ZERO_WEIGHT) {
+                throw std::domain_error("Edges' weights should be non-negative");
+            }
+        }
+        if (bidirectional) {
+            // Рёбра обратного графа добавляются в том же порядке, поэтому их id совпадают с исходными
+            reversed_graph_ = std::make_unique<Graph>(graph.GetVertexCount());
+            for (const auto& edge : graph.GetEdges()) {
+                reversed_graph_->AddEdge(Edge<Weight>{ edge.to, edge.from, edge.weight });
+            }
+            reversed_graph_->Freeze();
+        }
+    }
+
+    template <typename Weight>
+    std::optional<typename DijkstraRouter<Weight>::RouteInfo> DijkstraRouter<Weight>::BuildRoute(VertexId from,
+        VertexId to) const {
+        const size_t vertex_count = graph_.GetVertexCount();
+        if (from >= vertex_count || to >= vertex_count) {
+            throw std::out_of_range("Vertex id is out of range");
+        }
+        if (from == to) {
+            return RouteInfo{ ZERO_WEIGHT, {} };
+        }
+        Workspace& workspace = detail::GetThreadWorkspace<Weight>();
+        workspace.Start(vertex_count);
+        return reversed_graph_ ? BuildRouteBidirectional(from, to, workspace)
+            : BuildRouteForward(from, to, workspace);
+    }
+
+    template <typename Weight>
+    std::vector<std::optional<Weight>> DijkstraRouter<Weight>::ComputeRouteWeights(VertexId from,
+        const std::vector<VertexId>& targets) const {
+        const size_t vertex_count = graph_.GetVertexCount();
+        if (from >= vertex_count) {
+            throw std::out_of_range("Vertex id is out of range");
+        }
+        std::vector<VertexId> remaining_targets;
+        remaining_targets.reserve(targets.size());
+        for (const VertexId to : targets) {
+            if (to >= vertex_count) {
+                throw std::out_of_range("Vertex id is out of range");
+            }
+            remaining_targets.push_back(to);
+        }
+        std::sort(remaining_targets.begin(), remaining_targets.end());
+        remaining_targets.erase(std::unique(remaining_targets.begin(), remaining_targets.end()), remaining_targets.end());
+
+        Workspace& workspace = detail::GetThreadWorkspace<Weight>();
+        SearchState forward(workspace.forward, workspace.Start(vertex_count));
+        forward.Relax(from, ZERO_WEIGHT, NO_EDGE);
+        size_t remaining_count = remaining_targets.size();
+        while (remaining_count > 0 && forward.SkipSettled()) {
+            const VertexId vertex = forward.SettleTop();
+            if (std::binary_search(remaining_targets.begin(), remaining_targets.end(), vertex)) {
+                --remaining_count;
+            }
+            const Weight weight = forward.GetWeight(vertex);
+            graph_.ForEachIncidentEdge(vertex, [&](EdgeId edge_id, VertexId edge_to, Weight edge_weight) {
+                forward.Relax(edge_to, weight + edge_weight, edge_id);
+            });
+        }
+
+        std::vector<std::optional<Weight>> weights;
+        weights.reserve(targets.size());
+        for (const VertexId to : targets) {
+            weights.push_back(forward.IsSettled(to) ? std::optional<Weight>(forward.GetWeight(to)) : std::nullopt);
+        }
+        return weights;
+    }
+
+    template <typename Weight>
+    std::optional<typename DijkstraRouter<Weight>::RouteInfo> DijkstraRouter<Weight>::BuildRouteForward(VertexId from,
+        VertexId to, Workspace& workspace) const {
+        SearchState forward(workspace.forward, workspace.generation);
+        forward.Relax(from, ZERO_WEIGHT, NO_EDGE);
+        while (forward.SkipSettled()) {
+            const VertexId vertex = forward.SettleTop();
+            if (vertex == to) {
+                break;
+            }
+            const Weight weight = forward.GetWeight(vertex);
+            graph_.ForEachIncidentEdge(vertex, [&](EdgeId edge_id, VertexId edge_to, Weight edge_weight) {
+                forward.Relax(edge_to, weight + edge_weight, edge_id);
+            });
+        }
+        if (!forward.IsSettled(to)) {
+            return std::nullopt;
+        }
+
+        std::vector<EdgeId> edges;
+        for (EdgeId edge_id = forward.GetPrevEdge(to); edge_id != NO_EDGE;
+            edge_id = forward.GetPrevEdge(graph_.GetEdgeUnchecked(edge_id).from)) {
+            edges.push_back(edge_id);
+        }
+        std::reverse(edges.begin(), edges.end());
+        return RouteInfo{ forward.GetWeight(to), std::move(edges) };
+    }
+
+    template <typename Weight>
+    std::optional<typename DijkstraRouter<Weight>::RouteInfo> DijkstraRouter<Weight>::BuildRouteBidirectional(VertexId from,
+        VertexId to, Workspace& workspace) const {
+        SearchState forward(workspace.forward, workspace.generation);
+        SearchState backward(workspace.backward, workspace.generation);
+        forward.Relax(from, ZERO_WEIGHT, NO_EDGE);
+        backward.Relax(to, ZERO_WEIGHT, NO_EDGE);
+
+        std::optional<Weight> best_weight;
+        VertexId meeting_vertex = from;
+
+        auto update_best = [&](VertexId vertex) {
+            if (forward.IsReached(vertex) && backward.IsReached(vertex)) {
+                const Weight candidate = forward.GetWeight(vertex) + backward.GetWeight(vertex);
+                if (!best_weight || candidate < *best_weight) {
+                    best_weight = candidate;
+                    meeting_vertex = vertex;
+                }
+            }
+        };
+
+        auto step = [&update_best](SearchState& state, const Graph& graph) {
+            const VertexId vertex = state.SettleTop();
+            const Weight weight = state.GetWeight(vertex);
+            graph.ForEachIncidentEdge(vertex, [&](EdgeId edge_id, VertexId edge_to, Weight edge_weight) {
+                if (state.Relax(edge_to, weight + edge_weight, edge_id)) {
+                    update_best(edge_to);
+                }
+            });
+        };
+
+        update_best(from);
+        while (forward.SkipSettled() && backward.SkipSettled()) {
+            // Дальнейший поиск не может дать маршрута короче уже найденного
+            if (best_weight && !(forward.TopWeight() + backward.TopWeight() < *best_weight)) {
+                break;
+            }
+            if (!(backward.TopWeight() < forward.TopWeight())) {
+                step(forward, graph_);
+            }
+            else {
+                step(backward, *reversed_graph_);
+            }
+        }
+        if (!best_weight) {
+            return std::nullopt;
+        }
+
+        std::vector<EdgeId> edges;
+        for (EdgeId edge_id = forward.GetPrevEdge(meeting_vertex); edge_id != NO_EDGE;
+            edge_id = forward.GetPrevEdge(graph_.GetEdgeUnchecked(edge_id).from)) {
+            edges.push_back(edge_id);
+        }
+        std::reverse(edges.begin(), edges.end());
+        for (EdgeId edge_id = backward.GetPrevEdge(meeting_vertex); edge_id != NO_EDGE;
+            edge_id = backward.GetPrevEdge(graph_.GetEdgeUnchecked(edge_id).to)) {
+            edges.push_back(edge_id);
+        }
+        return RouteInfo{ *best_weight, std::move(edges) };
+    }
+
+}  // namespace graph
@@ -4,9 +4,9 @@ namespace transport_directory {
 
 	namespace domain {
 
-		Stop::Stop(std::string name_stop, geo::Coordinates coor) : name(std::move(name_stop)), coordinates(coor) {}
+		Stop::Stop(std::string_view name_stop, geo::Coordinates coor, StopId stop_id) : name(name_stop), coordinates(coor), id(stop_id) {}
 
-		BusRoute::BusRoute(std::string name_bus, std::vector<const Stop*> bus_route) : name(std::move(name_bus)), route(std::move(bus_route)) {}
+		BusRoute::BusRoute(std::string_view name_bus, RouteStops bus_route, BusId bus_id) : name(name_bus), route(bus_route), id(bus_id) {}
 
 	}// namespace domain
 }//namespace transport_directory
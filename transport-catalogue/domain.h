@@ -1,27 +1,37 @@
 #pragma once
 #include "geo.h"
+#include "ranges.h"
 
-#include <string>
-#include <vector>
+#include <cstdint>
+#include <string_view>
 
 
 namespace transport_directory {
 
 	namespace domain {
 
+		// Dense ids are positions of stops and buses in the catalogue in the order they were added
+		using StopId = uint32_t;
+		using BusId = uint32_t;
+
 		struct Stop {
 			Stop() = default;
-			Stop(std::string name_stop, geo::Coordinates coor);
-			std::string name;
+			Stop(std::string_view name_stop, geo::Coordinates coor, StopId stop_id = 0);
+			std::string_view name;// in the names arena of the catalogue
 			geo::Coordinates coordinates;
+			StopId id = 0;
 		};
 
+		// Stops of a bus, a part of the flat array of the catalogue
+		using RouteStops = ranges::Range<const Stop* const*>;
+
 		struct BusRoute {
 			BusRoute() = default;
-			BusRoute(std::string name_bus, std::vector<const Stop*> bus_route);
-			std::string name;
-			std::vector<const Stop*> route;
+			BusRoute(std::string_view name_bus, RouteStops bus_route, BusId bus_id = 0);
+			std::string_view name;// in the names arena of the catalogue
+			RouteStops route{ nullptr, nullptr };
 			bool is_roundtrip = false;
+			BusId id = 0;
 		};
 
 	}// namespace domain
@@ -2,6 +2,9 @@
 #include "ranges.h"
 
 #include <cstdlib>
+#include <limits>
+#include <stdexcept>
+#include <type_traits>
 #include <vector>
 
 namespace graph {
@@ -16,6 +19,20 @@ namespace graph {
         Weight weight;
     };
 
+    // Сумма весов. Целочисленные веса беззнаковые, и сумма насыщается на максимуме,
+    // который у них обозначает недостижимость, как бесконечность у вещественных
+    template <typename Weight>
+    Weight AddWeights(Weight lhs, Weight rhs) {
+        if constexpr (std::is_integral_v<Weight>) {
+            static_assert(std::is_unsigned_v<Weight>, "Integral weights should be unsigned");
+            const Weight sum = lhs + rhs;
+            return sum < lhs ? std::numeric_limits<Weight>::max() : sum;
+        }
+        else {
+            return lhs + rhs;
+        }
+    }
+
     template <typename Weight>
     class DirectedWeightedGraph {
     private:
@@ -27,6 +44,12 @@ namespace graph {
         explicit DirectedWeightedGraph(size_t vertex_count);
         EdgeId AddEdge(const Edge<Weight>& edge);
 
+        // Переводит граф в сжатое построчное представление (CSR): исходящие рёбра каждой вершины
+        // лежат подряд в порядке их id, а их концы и веса хранятся в отдельных массивах.
+        // После заморозки рёбра добавлять нельзя. Повторный вызов ничего не делает
+        void Freeze();
+        bool IsFrozen() const;
+
         size_t GetVertexCount() const;
         size_t GetEdgeCount() const;
         const Edge<Weight>& GetEdge(EdgeId edge_id) const;
@@ -34,27 +57,93 @@ namespace graph {
 
         const std::vector<Edge<Weight>>& GetEdges() const;
 
+        // Вызывает func(edge_id, to, weight) для каждого исходящего ребра вершины
+        template <typename Func>
+        void ForEachIncidentEdge(VertexId vertex, Func func) const;
+
+        // Методы без проверки границ для горячих циклов
+
+        const Edge<Weight>& GetEdgeUnchecked(EdgeId edge_id) const {
+            return edges_[edge_id];
+        }
+
+        // Для замороженного графа: исходящие рёбра вершины занимают позиции
+        // [GetArcsBegin(vertex), GetArcsEnd(vertex)) массивов CSR
+        size_t GetArcsBegin(VertexId vertex) const {
+            return offsets_[vertex];
+        }
+        size_t GetArcsEnd(VertexId vertex) const {
+            return offsets_[vertex + 1];
+        }
+        EdgeId GetArcEdge(size_t arc) const {
+            return arc_edges_[arc];
+        }
+        VertexId GetArcTarget(size_t arc) const {
+            return arc_targets_[arc];
+        }
+        Weight GetArcWeight(size_t arc) const {
+            return arc_weights_[arc];
+        }
+
     private:
+        size_t vertex_count_ = 0;
         std::vector<Edge<Weight>> edges_;
-        std::vector<IncidenceList> incidence_lists_;
+        std::vector<IncidenceList> incidence_lists_;// пуст после заморозки
+
+        // Представление CSR замороженного графа
+        std::vector<size_t> offsets_;
+        IncidenceList arc_edges_;
+        std::vector<VertexId> arc_targets_;
+        std::vector<Weight> arc_weights_;
     };
 
     template <typename Weight>
     DirectedWeightedGraph<Weight>::DirectedWeightedGraph(size_t vertex_count)
-        : incidence_lists_(vertex_count) {
+        : vertex_count_(vertex_count)
+        , incidence_lists_(vertex_count) {
     }
 
     template <typename Weight>
     EdgeId DirectedWeightedGraph<Weight>::AddEdge(const Edge<Weight>& edge) {
+        if (IsFrozen()) {
+            throw std::logic_error("Can't add an edge to a frozen graph");
+        }
         edges_.push_back(edge);
         const EdgeId id = edges_.size() - 1;
         incidence_lists_.at(edge.from).push_back(id);
         return id;
     }
 
+    template <typename Weight>
+    void DirectedWeightedGraph<Weight>::Freeze() {
+        if (IsFrozen()) {
+            return;
+        }
+        offsets_.reserve(vertex_count_ + 1);
+        arc_edges_.reserve(edges_.size());
+        arc_targets_.reserve(edges_.size());
+        arc_weights_.reserve(edges_.size());
+        offsets_.push_back(0);
+        for (const IncidenceList& incidence_list : incidence_lists_) {
+            for (const EdgeId edge_id : incidence_list) {
+                arc_edges_.push_back(edge_id);
+                arc_targets_.push_back(edges_[edge_id].to);
+                arc_weights_.push_back(edges_[edge_id].weight);
+            }
+            offsets_.push_back(arc_edges_.size());
+        }
+        // списки смежности больше не нужны: освобождаем и их память, и сам массив списков
+        std::vector<IncidenceList>().swap(incidence_lists_);
+    }
+
+    template <typename Weight>
+    bool DirectedWeightedGraph<Weight>::IsFrozen() const {
+        return !offsets_.empty();
+    }
+
     template <typename Weight>
     size_t DirectedWeightedGraph<Weight>::GetVertexCount() const {
-        return incidence_lists_.size();
+        return vertex_count_;
     }
 
     template <typename Weight>
@@ -70,6 +159,12 @@ namespace graph {
     template <typename Weight>
     typename DirectedWeightedGraph<Weight>::IncidentEdgesRange
         DirectedWeightedGraph<Weight>::GetIncidentEdges(VertexId vertex) const {
+        if (IsFrozen()) {
+            if (vertex >= vertex_count_) {
+                throw std::out_of_range("Vertex id is out of range");
+            }
+            return IncidentEdgesRange(arc_edges_.begin() + offsets_[vertex], arc_edges_.begin() + offsets_[vertex + 1]);
+        }
         return ranges::AsRange(incidence_lists_.at(vertex));
     }
 
@@ -77,4 +172,19 @@ namespace graph {
     const std::vector<Edge<Weight>>& DirectedWeightedGraph<Weight>::GetEdges() const {
         return edges_;
     }
+
+    template <typename Weight>
+    template <typename Func>
+    void DirectedWeightedGraph<Weight>::ForEachIncidentEdge(VertexId vertex, Func func) const {
+        if (IsFrozen()) {
+            for (size_t arc = offsets_[vertex]; arc < offsets_[vertex + 1]; ++arc) {
+                func(arc_edges_[arc], arc_targets_[arc], arc_weights_[arc]);
+            }
+            return;
+        }
+        for (const EdgeId edge_id : incidence_lists_[vertex]) {
+            const Edge<Weight>& edge = edges_[edge_id];
+            func(edge_id, edge.to, edge.weight);
+        }
+    }
 }  // namespace graph
\ No newline at end of file
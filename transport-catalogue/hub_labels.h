@@ -0,0 +1,380 @@
+#pragma once
+#include "contraction_hierarchy.h"
+#include "graph.h"
+#include "router_engine.h"
+#include "thread_pool.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <optional>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+namespace graph {
+
+    // Метки хабов, построенные по иерархии сжатия. Прямая метка вершины хранит веса маршрутов
+    // из неё в её хабы, обратная - из хабов в неё. Маршрут между вершинами проходит через общий хаб
+    // их прямой и обратной меток, поэтому запрос сводится к слиянию двух отсортированных массивов.
+    template <typename Weight>
+    class HubLabels : public RouterEngine<Weight> {
+    private:
+        using Graph = DirectedWeightedGraph<Weight>;
+        using Hierarchy = ContractionHierarchy<Weight>;
+
+    public:
+        using typename RouterEngine<Weight>::RouteInfo;
+
+        // Метки всех вершин в плоских массивах: метка вершины v занимает позиции [offsets[v], offsets[v + 1]),
+        // отсортированные по id хабов. parent_edges - ребро иерархии, с которого начинается маршрут
+        // в хаб (прямые метки) или которым заканчивается маршрут из хаба (обратные метки)
+        struct Labels {
+            std::vector<size_t> offsets;
+            std::vector<uint32_t> hubs;
+            std::vector<Weight> weights;
+            std::vector<uint32_t> parent_edges;// NO_PARENT_EDGE для самой вершины
+        };
+
+        struct LabelsData {
+            Labels forward;
+            Labels backward;
+        };
+
+        static constexpr uint32_t NO_PARENT_EDGE = std::numeric_limits<uint32_t>::max();
+
+        // thread_count == 0 означает число аппаратных потоков
+        explicit HubLabels(const Graph& graph, size_t thread_count = 1);
+
+        HubLabels(const Graph& graph, typename Hierarchy::HierarchyData hierarchy_data, LabelsData labels_data);
+
+        std::optional<RouteInfo> BuildRoute(VertexId from, VertexId to) const override;
+
+        std::optional<Weight> ComputeRouteWeight(VertexId from, VertexId to) const override;
+
+        const typename Hierarchy::HierarchyData& GetHierarchyData() const;
+
+        const LabelsData& GetData() const;
+
+        // Отдают иерархию и метки без копирования; после этого метки можно только разрушить
+        typename Hierarchy::HierarchyData ReleaseHierarchyData();
+
+        LabelsData ReleaseData();
+
+    private:
+        struct Entry {
+            uint32_t hub;
+            Weight weight;
+            uint32_t parent_edge;
+        };
+
+        struct BestHub {
+            Weight weight;
+            size_t forward_position;
+            size_t backward_position;
+        };
+
+        // Метки вершин строятся от больших рангов к меньшим: метка вершины собирается из меток соседей
+        // большего ранга, а записи, до хабов которых есть более короткий маршрут через другие хабы, отбрасываются.
+        // Вершины одного уровня зависят только от вершин меньших уровней и обрабатываются параллельно
+        void BuildLabels(size_t thread_count);
+
+        std::vector<Entry> ComputeLabel(VertexId vertex, bool is_forward,
+            const std::vector<std::vector<Entry>>& forward, const std::vector<std::vector<Entry>>& backward) const;
+
+        // Вес кратчайшего маршрута через общие хабы прямой метки from_label и обратной метки to_label
+        static std::optional<Weight> ComputeWeightThroughHubs(const std::vector<Entry>& from_label, const std::vector<Entry>& to_label);
+
+        static Labels FlattenLabels(std::vector<std::vector<Entry>>& labels);
+
+        static void CheckLabels(const Labels& labels, size_t vertex_count);
+
+        std::optional<BestHub> FindBestHub(VertexId from, VertexId to) const;
+
+        // Позиция записи хаба в метке вершины
+        static size_t FindHubPosition(const Labels& labels, VertexId vertex, uint32_t hub);
+
+        static constexpr Weight ZERO_WEIGHT{};
+        const Graph& graph_;
+        Hierarchy hierarchy_;
+        LabelsData data_;
+    };
+
+    template <typename Weight>
+    HubLabels<Weight>::HubLabels(const Graph& graph, size_t thread_count)
+        : graph_(graph)
+        , hierarchy_(graph)
+    {
+        BuildLabels(thread_count);
+    }
+
+    template <typename Weight>
+    HubLabels<Weight>::HubLabels(const Graph& graph, typename Hierarchy::HierarchyData hierarchy_data, LabelsData labels_data)
+        : graph_(graph)
+        , hierarchy_(graph, std::move(hierarchy_data))
+        , data_(std::move(labels_data))
+    {
+        CheckLabels(data_.forward, graph_.GetVertexCount());
+        CheckLabels(data_.backward, graph_.GetVertexCount());
+    }
+
+    template <typename Weight>
+    void HubLabels<Weight>::BuildLabels(size_t thread_count) {
+        const size_t vertex_count = graph_.GetVertexCount();
+        if (vertex_count >= NO_PARENT_EDGE || hierarchy_.GetData().edges.size() >= NO_PARENT_EDGE) {
+            throw std::length_error("Too many vertices or edges for 32-bit ids");
+        }
+        const auto& ranks = hierarchy_.GetData().ranks;
+        std::vector<VertexId> vertices_by_rank(vertex_count);
+        for (VertexId vertex = 0; vertex < vertex_count; ++vertex) {
+            vertices_by_rank[ranks[vertex]] = vertex;
+        }
+
+        // Уровень вершины на единицу больше наибольшего уровня её соседей большего ранга
+        std::vector<size_t> levels(vertex_count, 0);
+        std::vector<std::vector<VertexId>> vertices_by_level;
+        for (auto it = vertices_by_rank.rbegin(); it != vertices_by_rank.rend(); ++it) {
+            const VertexId vertex = *it;
+            size_t level = 0;
+            hierarchy_.ForEachUpwardEdge(vertex, [&](EdgeId, const auto& edge) {
+                level = std::max(level, levels[edge.to] + 1);
+            });
+            hierarchy_.ForEachDownwardEdge(vertex, [&](EdgeId, const auto& edge) {
+                level = std::max(level, levels[edge.from] + 1);
+            });
+            levels[vertex] = level;
+            if (vertices_by_level.size() <= level) {
+                vertices_by_level.resize(level + 1);
+            }
+            vertices_by_level[level].push_back(vertex);
+        }
+
+        std::vector<std::vector<Entry>> forward(vertex_count);
+        std::vector<std::vector<Entry>> backward(vertex_count);
+        parallel::ThreadPool pool(thread_count);
+        for (const auto& level_vertices : vertices_by_level) {
+            pool.ParallelFor(level_vertices.size(), [&](size_t index) {
+                const VertexId vertex = level_vertices[index];
+                forward[vertex] = ComputeLabel(vertex, true, forward, backward);
+                backward[vertex] = ComputeLabel(vertex, false, forward, backward);
+            });
+        }
+        data_.forward = FlattenLabels(forward);
+        data_.backward = FlattenLabels(backward);
+    }
+
+    template <typename Weight>
+    std::vector<typename HubLabels<Weight>::Entry> HubLabels<Weight>::ComputeLabel(VertexId vertex, bool is_forward,
+        const std::vector<std::vector<Entry>>& forward, const std::vector<std::vector<Entry>>& backward) const {
+        const auto& labels = is_forward ? forward : backward;
+        std::vector<Entry> candidates{ Entry{ static_cast<uint32_t>(vertex), ZERO_WEIGHT, NO_PARENT_EDGE } };
+        auto add_candidates = [&](EdgeId edge_id, VertexId neighbour, Weight edge_weight) {
+            for (const Entry& entry : labels[neighbour]) {
+                candidates.push_back(Entry{ entry.hub, edge_weight + entry.weight, static_cast<uint32_t>(edge_id) });
+            }
+        };
+        if (is_forward) {
+            hierarchy_.ForEachUpwardEdge(vertex, [&](EdgeId edge_id, const auto& edge) {
+                add_candidates(edge_id, edge.to, edge.weight);
+            });
+        }
+        else {
+            hierarchy_.ForEachDownwardEdge(vertex, [&](EdgeId edge_id, const auto& edge) {
+                add_candidates(edge_id, edge.from, edge.weight);
+            });
+        }
+
+        // Для каждого хаба остаётся самая лёгкая запись, а при равенстве - найденная первой
+        std::stable_sort(candidates.begin(), candidates.end(), [](const Entry& lhs, const Entry& rhs) {
+            return lhs.hub < rhs.hub || (lhs.hub == rhs.hub && lhs.weight < rhs.weight);
+        });
+        candidates.erase(std::unique(candidates.begin(), candidates.end(), [](const Entry& lhs, const Entry& rhs) {
+            return lhs.hub == rhs.hub;
+        }), candidates.end());
+
+        std::vector<Entry> label;
+        label.reserve(candidates.size());
+        for (const Entry& entry : candidates) {
+            const auto weight_through_hubs = is_forward
+                ? ComputeWeightThroughHubs(candidates, backward[entry.hub])
+                : ComputeWeightThroughHubs(forward[entry.hub], candidates);
+            if (entry.hub == vertex || !weight_through_hubs || !(*weight_through_hubs < entry.weight)) {
+                label.push_back(entry);
+            }
+        }
+        return label;
+    }
+
+    template <typename Weight>
+    std::optional<Weight> HubLabels<Weight>::ComputeWeightThroughHubs(const std::vector<Entry>& from_label,
+        const std::vector<Entry>& to_label) {
+        std::optional<Weight> best_weight;
+        auto from_it = from_label.begin();
+        auto to_it = to_label.begin();
+        while (from_it != from_label.end() && to_it != to_label.end()) {
+            if (from_it->hub < to_it->hub) {
+                ++from_it;
+            }
+            else if (to_it->hub < from_it->hub) {
+                ++to_it;
+            }
+            else {
+                const Weight weight = from_it->weight + to_it->weight;
+                if (!best_weight || weight < *best_weight) {
+                    best_weight = weight;
+                }
+                ++from_it;
+                ++to_it;
+            }
+        }
+        return best_weight;
+    }
+
+    template <typename Weight>
+    typename HubLabels<Weight>::Labels HubLabels<Weight>::FlattenLabels(std::vector<std::vector<Entry>>& labels) {
+        Labels result;
+        result.offsets.reserve(labels.size() + 1);
+        result.offsets.push_back(0);
+        for (const auto& label : labels) {
+            result.offsets.push_back(result.offsets.back() + label.size());
+        }
+        result.hubs.reserve(result.offsets.back());
+        result.weights.reserve(result.offsets.back());
+        result.parent_edges.reserve(result.offsets.back());
+        for (auto& label : labels) {
+            for (const Entry& entry : label) {
+                result.hubs.push_back(entry.hub);
+                result.weights.push_back(entry.weight);
+                result.parent_edges.push_back(entry.parent_edge);
+            }
+            label = {};
+        }
+        return result;
+    }
+
+    template <typename Weight>
+    void HubLabels<Weight>::CheckLabels(const Labels& labels, size_t vertex_count) {
+        const size_t entry_count = labels.hubs.size();
+        if (labels.offsets.size() != vertex_count + 1 || labels.offsets.front() != 0 || labels.offsets.back() != entry_count
+            || labels.weights.size() != entry_count || labels.parent_edges.size() != entry_count
+            || !std::is_sorted(labels.offsets.begin(), labels.offsets.end())) {
+            throw std::invalid_argument("Hub labels don't match the graph");
+        }
+    }
+
+    template <typename Weight>
+    std::optional<typename HubLabels<Weight>::BestHub> HubLabels<Weight>::FindBestHub(VertexId from, VertexId to) const {
+        const Labels& forward = data_.forward;
+        const Labels& backward = data_.backward;
+        std::optional<BestHub> best_hub;
+        size_t forward_position = forward.offsets[from];
+        size_t backward_position = backward.offsets[to];
+        const size_t forward_end = forward.offsets[from + 1];
+        const size_t backward_end = backward.offsets[to + 1];
+        while (forward_position < forward_end && backward_position < backward_end) {
+            const uint32_t forward_hub = forward.hubs[forward_position];
+            const uint32_t backward_hub = backward.hubs[backward_position];
+            if (forward_hub < backward_hub) {
+                ++forward_position;
+            }
+            else if (backward_hub < forward_hub) {
+                ++backward_position;
+            }
+            else {
+                const Weight weight = forward.weights[forward_position] + backward.weights[backward_position];
+                if (!best_hub || weight < best_hub->weight) {
+                    best_hub = BestHub{ weight, forward_position, backward_position };
+                }
+                ++forward_position;
+                ++backward_position;
+            }
+        }
+        return best_hub;
+    }
+
+    template <typename Weight>
+    size_t HubLabels<Weight>::FindHubPosition(const Labels& labels, VertexId vertex, uint32_t hub) {
+        const auto begin = labels.hubs.begin() + labels.offsets[vertex];
+        const auto end = labels.hubs.begin() + labels.offsets[vertex + 1];
+        const auto it = std::lower_bound(begin, end, hub);
+        if (it == end || *it != hub) {
+            throw std::logic_error("Hub labels are inconsistent");
+        }
+        return it - labels.hubs.begin();
+    }
+
+    template <typename Weight>
+    std::optional<typename HubLabels<Weight>::RouteInfo> HubLabels<Weight>::BuildRoute(VertexId from, VertexId to) const {
+        const size_t vertex_count = graph_.GetVertexCount();
+        if (from >= vertex_count || to >= vertex_count) {
+            throw std::out_of_range("Vertex id is out of range");
+        }
+        if (from == to) {
+            return RouteInfo{ ZERO_WEIGHT, {} };
+        }
+        const auto best_hub = FindBestHub(from, to);
+        if (!best_hub) {
+            return std::nullopt;
+        }
+        const auto& hierarchy_edges = hierarchy_.GetData().edges;
+        const uint32_t hub = data_.forward.hubs[best_hub->forward_position];
+
+        // Рёбра иерархии от from до хаба идут по родительским рёбрам прямых меток,
+        // от хаба до to - по родительским рёбрам обратных меток в обратном порядке
+        std::vector<EdgeId> route_hierarchy_edges;
+        for (size_t position = best_hub->forward_position; data_.forward.parent_edges[position] != NO_PARENT_EDGE;) {
+            const uint32_t edge_id = data_.forward.parent_edges[position];
+            route_hierarchy_edges.push_back(edge_id);
+            position = FindHubPosition(data_.forward, hierarchy_edges[edge_id].to, hub);
+        }
+        const size_t forward_edge_count = route_hierarchy_edges.size();
+        for (size_t position = best_hub->backward_position; data_.backward.parent_edges[position] != NO_PARENT_EDGE;) {
+            const uint32_t edge_id = data_.backward.parent_edges[position];
+            route_hierarchy_edges.push_back(edge_id);
+            position = FindHubPosition(data_.backward, hierarchy_edges[edge_id].from, hub);
+        }
+        std::reverse(route_hierarchy_edges.begin() + forward_edge_count, route_hierarchy_edges.end());
+
+        std::vector<EdgeId> edges;
+        for (const EdgeId edge_id : route_hierarchy_edges) {
+            hierarchy_.UnpackEdge(edge_id, edges);
+        }
+        return RouteInfo{ best_hub->weight, std::move(edges) };
+    }
+
+    template <typename Weight>
+    std::optional<Weight> HubLabels<Weight>::ComputeRouteWeight(VertexId from, VertexId to) const {
+        const size_t vertex_count = graph_.GetVertexCount();
+        if (from >= vertex_count || to >= vertex_count) {
+            throw std::out_of_range("Vertex id is out of range");
+        }
+        if (from == to) {
+            return ZERO_WEIGHT;
+        }
+        if (const auto best_hub = FindBestHub(from, to)) {
+            return best_hub->weight;
+        }
+        return std::nullopt;
+    }
+
+    template <typename Weight>
+    const typename HubLabels<Weight>::Hierarchy::HierarchyData& HubLabels<Weight>::GetHierarchyData() const {
+        return hierarchy_.GetData();
+    }
+
+    template <typename Weight>
+    const typename HubLabels<Weight>::LabelsData& HubLabels<Weight>::GetData() const {
+        return data_;
+    }
+
+    template <typename Weight>
+    typename HubLabels<Weight>::Hierarchy::HierarchyData HubLabels<Weight>::ReleaseHierarchyData() {
+        return hierarchy_.ReleaseData();
+    }
+
+    template <typename Weight>
+    typename HubLabels<Weight>::LabelsData HubLabels<Weight>::ReleaseData() {
+        return std::move(data_);
+    }
+
+}  // namespace graph
@@ -0,0 +1,65 @@
+#pragma once
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+
+#ifdef __linux__
+#include <sys/mman.h>
+#endif
+
+namespace memory {
+
+    inline constexpr size_t HUGE_PAGE_SIZE = 2 * 1024 * 1024;
+
+    // Аллокатор для больших плоских массивов: блоки от размера огромной страницы
+    // выравниваются по её границе и помечаются для ядра как кандидаты в огромные страницы.
+    // На других платформах работает как обычный аллокатор.
+    template <typename T>
+    class HugePageAllocator {
+    public:
+        using value_type = T;
+
+        HugePageAllocator() = default;
+
+        template <typename U>
+        HugePageAllocator(const HugePageAllocator<U>&) noexcept {
+        }
+
+        T* allocate(size_t count) {
+            const size_t bytes = count * sizeof(T);
+#ifdef __linux__
+            if (bytes >= HUGE_PAGE_SIZE) {
+                const size_t rounded_bytes = (bytes + HUGE_PAGE_SIZE - 1) / HUGE_PAGE_SIZE * HUGE_PAGE_SIZE;
+                void* ptr = std::aligned_alloc(HUGE_PAGE_SIZE, rounded_bytes);
+                if (!ptr) {
+                    throw std::bad_alloc();
+                }
+                madvise(ptr, rounded_bytes, MADV_HUGEPAGE);
+                return static_cast<T*>(ptr);
+            }
+#endif
+            return static_cast<T*>(::operator new(bytes));
+        }
+
+        void deallocate(T* ptr, size_t count) noexcept {
+#ifdef __linux__
+            if (count * sizeof(T) >= HUGE_PAGE_SIZE) {
+                std::free(ptr);
+                return;
+            }
+#endif
+            ::operator delete(ptr);
+        }
+    };
+
+    template <typename T, typename U>
+    bool operator==(const HugePageAllocator<T>&, const HugePageAllocator<U>&) {
+        return true;
+    }
+
+    template <typename T, typename U>
+    bool operator!=(const HugePageAllocator<T>&, const HugePageAllocator<U>&) {
+        return false;
+    }
+
+}  // namespace memory
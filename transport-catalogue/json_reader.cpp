@@ -8,11 +8,14 @@
 #include <variant>
 #include <fstream>
 #include <filesystem>
+#include <map>
+#include <unordered_map>
+#include <unordered_set>
 
 namespace transport_directory {
 	namespace json_reader {
 
-		void PrintAnswearsForRequests(const json::Document& doc, const DownloadedDataForTransportRouter& data, std::ostream& os) {
+		void PrintAnswearsForRequests(const json::Document& doc, DownloadedDataForTransportRouter&& data, std::ostream& os) {
 			using namespace std::literals;
 			const json::Array& requests = doc.GetRoot().AsDict().at("stat_requests"s).AsArray();
 			json::Array answears;
@@ -20,8 +23,9 @@ namespace transport_directory {
 			answears.reserve(requests.size());
 			std::unique_ptr<transport_router::TransportRouter> router_ptr;
 			router_ptr = data.data_for_router ?
-				std::make_unique<transport_router::TransportRouter>(data.guide, data.routing_settings, *data.data_for_router)
+				std::make_unique<transport_router::TransportRouter>(data.guide, data.routing_settings, std::move(*data.data_for_router))
 				: std::make_unique<transport_router::TransportRouter>(data.guide, data.routing_settings);
+			std::unique_ptr<transport_router::RouteCache> route_cache = detail::CreateRouteCache(doc, data.guide, *router_ptr);
 			for (const auto& node : requests) {
 				const auto& request = node.AsDict();
 				if (request.at(type).AsString() == "Bus"s) {
@@ -34,7 +38,13 @@ namespace transport_directory {
 					answears.push_back(detail::RequestMap(data.render_settings, request, data.guide));
 				}
 				else if (request.at(type).AsString() == "Route"s) {
-					answears.push_back(detail::RequestFindRoute(request, *router_ptr));
+					answears.push_back(detail::RequestFindRoute(request, *router_ptr, route_cache.get()));
+				}
+				else if (request.at(type).AsString() == "RouteMatrix"s) {
+					answears.push_back(detail::RequestRouteMatrix(request, data.guide, *router_ptr));
+				}
+				else if (request.at(type).AsString() == "RouteCache"s) {
+					answears.push_back(detail::RequestRouteCacheStats(request, route_cache.get()));
 				}
 			}
 			json::Document doc_with_answears(std::move(answears));
@@ -47,26 +57,7 @@ namespace transport_directory {
 			for (const auto& node : doc.GetRoot().AsDict().at("base_requests"s).AsArray()) {
 				objects.push_back(detail::ParseRequestToFillTransportGuide(node));
 			}
-
-			std::for_each(objects.begin(), objects.end(), [&guide](const detail::TransportObject& tr_obj) {
-				if (tr_obj.type == detail::TypeTransportObject::STOP) {
-					guide.AddStop(std::string(tr_obj.name), tr_obj.coordinates);
-				}
-				});
-			std::for_each(objects.begin(), objects.end(), [&guide](const detail::TransportObject& tr_obj) {
-				if (tr_obj.type == detail::TypeTransportObject::STOP) {
-					const domain::Stop* from = guide.SearchStop(tr_obj.name);
-					for (const auto& [stop_to, distance] : tr_obj.distances_to) {
-						const domain::Stop* to = guide.SearchStop(stop_to);
-						guide.SetDistance(from, to, distance);
-					}
-				}
-				});
-			std::for_each(objects.begin(), objects.end(), [&guide](detail::TransportObject& tr_obj) {
-				if (tr_obj.type == detail::TypeTransportObject::BUS) {
-					guide.AddBusRoute(std::string(tr_obj.name), std::move(tr_obj.stops), tr_obj.is_roundtrip);
-				}
-				});
+			detail::FillTransportGuide(objects, guide);
 		}
 
 		svg::Document CreateSvgDocumentMap(const renderer::MapRenderer& renderer, const transport_catalogue::TransportCatalogue& guide) {
@@ -90,14 +81,14 @@ namespace transport_directory {
 			CreateSvgDocumentMap(renderer::MapRenderer(render_settings), guide).Render(os);
 		}
 
-		bool SaveDataToFile(const json::Document& doc, const DownloadedDataForTransportRouter& data) {
+		bool SaveDataToFile(const json::Document& doc, DownloadedDataForTransportRouter&& data) {
 			using namespace std::literals;
 			std::filesystem::path file = doc.GetRoot().AsDict().at("serialization_settings"s).AsDict().at("file").AsString();
 			std::ofstream out(file, std::ios::binary);
 			if (!out) {
 				return false;
 			}
-			if (serialization_tr_catalogue::SaveDataForTransportRouter(out, data)) {
+			if (serialization_tr_catalogue::SaveDataForTransportRouter(out, std::move(data))) {
 				return true;
 			}
 			return false;
@@ -119,6 +110,20 @@ namespace transport_directory {
 			LoadTransportGuide(doc, data.guide);
 			data.render_settings = detail::LoadRenderSettings(doc);
 			data.routing_settings = detail::LoadRoutingSettings(doc);
+			data.guide.ComputeBusStats(data.routing_settings.thread_count);
+			return data;
+		}
+
+		DownloadedDataForTransportRouter UpdateDataFromJson(const json::Document& doc, const DownloadedDataForTransportRouter& base) {
+			using namespace std::literals;
+			const json::Dict& root = doc.GetRoot().AsDict();
+			DownloadedDataForTransportRouter data;
+			std::vector<detail::TransportObject> objects = detail::GetTransportObjects(base.guide);
+			detail::ApplyChangesToObjects(doc, objects);
+			detail::FillTransportGuide(objects, data.guide);
+			data.render_settings = root.count("render_settings"s) ? detail::LoadRenderSettings(doc) : base.render_settings;
+			data.routing_settings = root.count("routing_settings"s) ? detail::LoadRoutingSettings(doc) : base.routing_settings;
+			data.guide.ComputeBusStats(data.routing_settings.thread_count);
 			return data;
 		}
 
@@ -127,19 +132,212 @@ namespace transport_directory {
 			transport_router::TransportRouter::RoutingSettings LoadRoutingSettings(const json::Document& doc) {
 				using namespace std::literals;
 				const json::Dict& settings = doc.GetRoot().AsDict().at("routing_settings"s).AsDict();
-				return { static_cast<size_t>(settings.at("bus_wait_time"s).AsInt()), settings.at("bus_velocity"s).AsDouble() };
+				transport_router::TransportRouter::RoutingSettings routing_settings;
+				routing_settings.bus_wait_time = static_cast<size_t>(settings.at("bus_wait_time"s).AsInt());
+				routing_settings.bus_velocity = settings.at("bus_velocity"s).AsDouble();
+				if (auto it = settings.find("router_type"s); it != settings.end()) {
+					routing_settings.router_type = LoadRouterType(it->second);
+				}
+				if (auto it = settings.find("bidirectional_search"s); it != settings.end()) {
+					routing_settings.bidirectional_search = it->second.AsBool();
+				}
+				if (auto it = settings.find("thread_count"s); it != settings.end()) {
+					routing_settings.thread_count = static_cast<size_t>(it->second.AsInt());
+				}
+				if (auto it = settings.find("graph_model"s); it != settings.end()) {
+					routing_settings.graph_model = LoadGraphModel(it->second);
+				}
+				if (auto it = settings.find("closed_stops"s); it != settings.end()) {
+					for (const json::Node& name : it->second.AsArray()) {
+						routing_settings.closed_stops.push_back(name.AsString());
+					}
+				}
+				return routing_settings;
+			}
+
+			transport_router::TransportRouter::RouterType LoadRouterType(const json::Node& node) {
+				using namespace std::literals;
+				const std::string& type = node.AsString();
+				if (type == "all_pairs"s) {
+					return transport_router::TransportRouter::RouterType::ALL_PAIRS;
+				}
+				else if (type == "on_demand"s) {
+					return transport_router::TransportRouter::RouterType::ON_DEMAND;
+				}
+				else if (type == "contraction_hierarchy"s) {
+					return transport_router::TransportRouter::RouterType::CONTRACTION_HIERARCHY;
+				}
+				else if (type == "raptor"s) {
+					return transport_router::TransportRouter::RouterType::RAPTOR;
+				}
+				else if (type == "hub_labels"s) {
+					return transport_router::TransportRouter::RouterType::HUB_LABELS;
+				}
+				else if (type == "customizable_contraction_hierarchy"s) {
+					return transport_router::TransportRouter::RouterType::CUSTOMIZABLE_CONTRACTION_HIERARCHY;
+				}
+				throw std::invalid_argument("Unknown router type: "s + type);
+			}
+
+			transport_router::TransportRouter::GraphModel LoadGraphModel(const json::Node& node) {
+				using namespace std::literals;
+				const std::string& model = node.AsString();
+				if (model == "stop_pairs"s) {
+					return transport_router::TransportRouter::GraphModel::STOP_PAIRS;
+				}
+				else if (model == "ride_vertices"s) {
+					return transport_router::TransportRouter::GraphModel::RIDE_VERTICES;
+				}
+				else if (model == "stop_vertices"s) {
+					return transport_router::TransportRouter::GraphModel::STOP_VERTICES;
+				}
+				throw std::invalid_argument("Unknown graph model: "s + model);
+			}
+
+			std::unique_ptr<transport_router::RouteCache> CreateRouteCache(const json::Document& doc,
+				const transport_catalogue::TransportCatalogue& guide, const transport_router::TransportRouter& router) {
+				using namespace std::literals;
+				const json::Dict& root = doc.GetRoot().AsDict();
+				auto it = root.find("route_cache"s);
+				if (it == root.end()) {
+					return nullptr;
+				}
+				const json::Dict& settings = it->second.AsDict();
+				size_t shard_count = transport_router::RouteCache::DEFAULT_SHARD_COUNT;
+				if (auto it_shards = settings.find("shard_count"s); it_shards != settings.end()) {
+					shard_count = static_cast<size_t>(it_shards->second.AsInt());
+				}
+				auto route_cache = std::make_unique<transport_router::RouteCache>(guide, router,
+					static_cast<size_t>(settings.at("capacity"s).AsInt()), shard_count);
+				if (auto it_file = settings.find("warm_up_file"s); it_file != settings.end()) {
+					std::ifstream ifs(std::filesystem::path(it_file->second.AsString()));
+					if (ifs.good()) {
+						WarmUpRouteCache(ifs, *route_cache);
+					}
+				}
+				return route_cache;
 			}
 
-			json::Node RequestFindRoute(const json::Dict& request, const transport_router::TransportRouter& router) {
+			void WarmUpRouteCache(std::istream& input, transport_router::RouteCache& route_cache) {
 				using namespace std::literals;
-				auto route_info = router.BuildRoute(request.at("from"s).AsString(), request.at("to"s).AsString());
+				std::string line;
+				while (std::getline(input, line)) {
+					if (line.find_first_not_of(" \t\r"s) == std::string::npos) {
+						continue;
+					}
+					std::istringstream line_stream(line);
+					const json::Document request_doc = json::Load(line_stream);
+					if (!request_doc.GetRoot().IsDict()) {
+						continue;
+					}
+					const json::Dict& request = request_doc.GetRoot().AsDict();
+					auto it_type = request.find("type"s);
+					if (it_type == request.end() || !it_type->second.IsString() || it_type->second.AsString() != "Route"s) {
+						continue;
+					}
+					route_cache.Preload(request.at("from"s).AsString(), request.at("to"s).AsString());
+				}
+			}
+
+			json::Node RequestFindRoute(const json::Dict& request, const transport_router::TransportRouter& router,
+				transport_router::RouteCache* route_cache) {
+				using namespace std::literals;
+				const std::string& from = request.at("from"s).AsString();
+				const std::string& to = request.at("to"s).AsString();
 				int request_id = request.at("id"s).AsInt();
+				// the cache keeps routes of the routing settings only
+				if (auto profile = LoadRoutingProfile(request)) {
+					auto route_info = router.BuildRoute(from, to, *profile);
+					if (!route_info) {
+						return ErrorMessageNotFound(request_id);
+					}
+					return RouteInfoToJson(*route_info, request_id);
+				}
+				if (route_cache) {
+					auto route_info = route_cache->BuildRoute(from, to);
+					if (!route_info) {
+						return ErrorMessageNotFound(request_id);
+					}
+					return RouteInfoToJson(*route_info, request_id);
+				}
+				auto route_info = router.BuildRoute(from, to);
 				if (!route_info) {
 					return ErrorMessageNotFound(request_id);
 				}
 				return RouteInfoToJson(*route_info, request_id);
 			}
 
+			std::optional<transport_router::TransportRouter::RoutingProfile> LoadRoutingProfile(const json::Dict& request) {
+				using namespace std::literals;
+				transport_router::TransportRouter::RoutingProfile profile;
+				bool has_profile = false;
+				if (auto it = request.find("max_transfers"s); it != request.end()) {
+					profile.max_transfers = static_cast<size_t>(it->second.AsInt());
+					has_profile = true;
+				}
+				if (auto it = request.find("bus_wait_time"s); it != request.end()) {
+					profile.bus_wait_time = static_cast<size_t>(it->second.AsInt());
+					has_profile = true;
+				}
+				if (auto it = request.find("bus_velocity"s); it != request.end()) {
+					profile.bus_velocity = it->second.AsDouble();
+					has_profile = true;
+				}
+				if (auto it = request.find("bus_speed_factors"s); it != request.end()) {
+					for (const auto& [name, factor] : it->second.AsDict()) {
+						profile.bus_speed_factors.emplace(name, factor.AsDouble());
+					}
+					has_profile = true;
+				}
+				if (!has_profile) {
+					return std::nullopt;
+				}
+				return profile;
+			}
+
+			json::Node RequestRouteMatrix(const json::Dict& request, const transport_catalogue::TransportCatalogue& guide,
+				const transport_router::TransportRouter& router) {
+				using namespace std::literals;
+				auto load_stops = [&guide](const json::Node& node) {
+					std::vector<const domain::Stop*> stops;
+					stops.reserve(node.AsArray().size());
+					for (const auto& name : node.AsArray()) {
+						stops.push_back(guide.SearchStop(name.AsString()));
+					}
+					return stops;
+				};
+				const auto matrix = router.ComputeRouteMatrix(load_stops(request.at("from"s)), load_stops(request.at("to"s)));
+				json::Array total_times;
+				total_times.reserve(matrix.size());
+				for (const auto& row : matrix) {
+					json::Array json_row;
+					json_row.reserve(row.size());
+					for (const auto& weight : row) {
+						json_row.push_back(weight ? json::Node(transport_router::WeightToMinutes(*weight)) : json::Node(nullptr));
+					}
+					total_times.push_back(std::move(json_row));
+				}
+				return json::Builder().StartDict()
+					.Key("request_id"s).Value(request.at("id"s).AsInt())
+					.Key("total_times"s).Value(std::move(total_times))
+					.EndDict().Build();
+			}
+
+			json::Node RequestRouteCacheStats(const json::Dict& request, const transport_router::RouteCache* route_cache) {
+				using namespace std::literals;
+				int request_id = request.at("id"s).AsInt();
+				if (!route_cache) {
+					return ErrorMessageNotFound(request_id);
+				}
+				const auto stats = route_cache->GetStats();
+				return json::Builder().StartDict()
+					.Key("request_id"s).Value(request_id)
+					.Key("hit_count"s).Value(static_cast<int>(stats.hit_count))
+					.Key("miss_count"s).Value(static_cast<int>(stats.miss_count))
+					.Key("size"s).Value(static_cast<int>(stats.size))
+					.EndDict().Build();
+			}
+
 			json::Node RequestBusRoute(const json::Dict& request, const transport_catalogue::TransportCatalogue& guide) {
 				using namespace std::literals;
 				const auto stat = guide.RequestStatBusRoute(request.at("name"s).AsString());
@@ -180,8 +378,8 @@ namespace transport_directory {
 				if (stat.buses_) {
 					json::Array arr;
 					arr.reserve(stat.buses_->size());
-					for (const auto& bus : *stat.buses_) {
-						arr.push_back(json::Builder().Value(std::string(bus)).Build());
+					for (const domain::BusRoute* bus : *stat.buses_) {
+						arr.push_back(json::Builder().Value(std::string(bus->name)).Build());
 					}
 					return json::Builder().StartDict()
 						.Key("request_id"s).Value(request_id)
@@ -209,23 +407,23 @@ namespace transport_directory {
 						const domain::Stop* stop = std::get<const domain::Stop*>(data_edge.obj);
 						items.push_back(json::Builder().StartDict()
 							.Key("type"s).Value("Wait"s)
-							.Key("stop_name"s).Value(stop->name)
-							.Key("time"s).Value(data_edge.weight)
+							.Key("stop_name"s).Value(std::string(stop->name))
+							.Key("time"s).Value(transport_router::WeightToMinutes(data_edge.weight))
 							.EndDict().Build());
 					}
 					else {
 						const domain::BusRoute* bus = std::get<const domain::BusRoute*>(data_edge.obj);
 						items.push_back(json::Builder().StartDict()
 							.Key("type"s).Value("Bus"s)
-							.Key("bus"s).Value(bus->name)
+							.Key("bus"s).Value(std::string(bus->name))
 							.Key("span_count"s).Value(data_edge.spun_count)
-							.Key("time"s).Value(data_edge.weight)
+							.Key("time"s).Value(transport_router::WeightToMinutes(data_edge.weight))
 							.EndDict().Build());
 					}
 				}
 				return json::Builder().StartDict()
 					.Key("request_id"s).Value(request_id)
-					.Key("total_time"s).Value(route_info.weight)
+					.Key("total_time"s).Value(transport_router::WeightToMinutes(route_info.weight))
 					.Key("items"s).Value(std::move(items))
 					.EndDict().Build();
 			}
@@ -238,6 +436,123 @@ namespace transport_directory {
 					.EndDict().Build();
 			}
 
+			void FillTransportGuide(std::vector<TransportObject>& objects, transport_catalogue::TransportCatalogue& guide) {
+				size_t stop_count = 0;
+				size_t route_stop_count = 0;
+				for (const TransportObject& tr_obj : objects) {
+					stop_count += tr_obj.type == TypeTransportObject::STOP ? 1 : 0;
+					route_stop_count += tr_obj.stops.size();
+				}
+				guide.Reserve(stop_count, objects.size() - stop_count, route_stop_count);
+				std::for_each(objects.begin(), objects.end(), [&guide](const TransportObject& tr_obj) {
+					if (tr_obj.type == TypeTransportObject::STOP) {
+						guide.AddStop(tr_obj.name, tr_obj.coordinates);
+					}
+					});
+				std::for_each(objects.begin(), objects.end(), [&guide](const TransportObject& tr_obj) {
+					if (tr_obj.type == TypeTransportObject::STOP) {
+						const domain::Stop* from = guide.SearchStop(tr_obj.name);
+						for (const auto& [stop_to, distance] : tr_obj.distances_to) {
+							const domain::Stop* to = guide.SearchStop(stop_to);
+							guide.SetDistance(from, to, distance);
+						}
+					}
+					});
+				guide.BuildDistances();
+				std::for_each(objects.begin(), objects.end(), [&guide](const TransportObject& tr_obj) {
+					if (tr_obj.type == TypeTransportObject::BUS) {
+						guide.AddBusRoute(tr_obj.name, tr_obj.stops, tr_obj.is_roundtrip);
+					}
+					});
+				guide.BuildStopBuses();
+			}
+
+			std::vector<TransportObject> GetTransportObjects(const transport_catalogue::TransportCatalogue& guide) {
+				std::vector<TransportObject> objects;
+				const auto& stops = guide.GetStops();
+				for (const auto& stop : stops) {
+					TransportObject obj;
+					obj.type = TypeTransportObject::STOP;
+					obj.name = std::string(stop.name);
+					obj.coordinates = stop.coordinates;
+					objects.push_back(std::move(obj));
+				}
+				for (const auto& distance : guide.GetDistances()) {
+					// stops go first in objects by their ids
+					objects[distance.from].distances_to.emplace_back(stops[distance.to].name, distance.distance);
+				}
+				for (const auto& bus_route : guide.GetBusRoutes()) {
+					TransportObject obj;
+					obj.type = TypeTransportObject::BUS;
+					obj.name = std::string(bus_route.name);
+					for (const domain::Stop* stop : bus_route.route) {
+						obj.stops.emplace_back(stop->name);
+					}
+					obj.is_roundtrip = bus_route.is_roundtrip;
+					objects.push_back(std::move(obj));
+				}
+				return objects;
+			}
+
+			void ApplyChangesToObjects(const json::Document& doc, std::vector<TransportObject>& objects) {
+				using namespace std::literals;
+				const json::Dict& root = doc.GetRoot().AsDict();
+				auto load_names = [&root](const std::string& key) {
+					std::unordered_set<std::string> names;
+					if (auto it = root.find(key); it != root.end()) {
+						for (const auto& name : it->second.AsArray()) {
+							names.insert(name.AsString());
+						}
+					}
+					return names;
+				};
+				const auto removed_stops = load_names("removed_stops"s);
+				const auto removed_buses = load_names("removed_buses"s);
+
+				std::map<std::pair<TypeTransportObject, std::string>, size_t> indexes;
+				for (size_t i = 0; i < objects.size(); ++i) {
+					indexes.emplace(std::pair{ objects[i].type, objects[i].name }, i);
+				}
+				if (auto it = root.find("base_requests"s); it != root.end()) {
+					for (const auto& node : it->second.AsArray()) {
+						TransportObject obj = ParseRequestToFillTransportGuide(node);
+						auto [it_index, is_new] = indexes.emplace(std::pair{ obj.type, obj.name }, objects.size());
+						if (is_new) {
+							objects.push_back(std::move(obj));
+							continue;
+						}
+						TransportObject& previous = objects[it_index->second];
+						if (obj.type == TypeTransportObject::STOP) {
+							// the given distances replace the previous ones, the others are kept
+							for (const auto& distance : previous.distances_to) {
+								if (std::none_of(obj.distances_to.begin(), obj.distances_to.end(),
+									[&distance](const auto& new_distance) { return new_distance.first == distance.first; })) {
+									obj.distances_to.push_back(distance);
+								}
+							}
+						}
+						previous = std::move(obj);
+					}
+				}
+
+				objects.erase(std::remove_if(objects.begin(), objects.end(), [&](const TransportObject& obj) {
+					return obj.type == TypeTransportObject::STOP ? removed_stops.count(obj.name) > 0 : removed_buses.count(obj.name) > 0;
+					}), objects.end());
+				for (TransportObject& obj : objects) {
+					if (obj.type == TypeTransportObject::STOP) {
+						obj.distances_to.erase(std::remove_if(obj.distances_to.begin(), obj.distances_to.end(), [&](const auto& distance) {
+							return removed_stops.count(distance.first) > 0;
+							}), obj.distances_to.end());
+						continue;
+					}
+					for (const std::string& stop : obj.stops) {
+						if (removed_stops.count(stop)) {
+							throw std::invalid_argument("Removed stop "s + stop + " is used by bus "s + obj.name);
+						}
+					}
+				}
+			}
+
 			void ParseDistancesToStops(const json::Node& node, TransportObject& obj) {
 				for (const auto& [stop, distance] : node.AsDict()) {
 					obj.distances_to.emplace_back(stop, distance.AsDouble());
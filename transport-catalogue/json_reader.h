@@ -5,6 +5,7 @@
 #include "map_renderer.h"
 #include "svg.h"
 #include "transport_router.h"
+#include "route_cache.h"
 
 #include <iostream>
 #include <vector>
@@ -22,7 +23,8 @@ namespace transport_directory {
 			std::unique_ptr<transport_router::TransportRouter::DownloadedData> data_for_router;
 		};
 
-		void PrintAnswearsForRequests(const json::Document& doc, const DownloadedDataForTransportRouter& data, std::ostream& os = std::cout);
+		// The data of the router is moved into the router answering the requests
+		void PrintAnswearsForRequests(const json::Document& doc, DownloadedDataForTransportRouter&& data, std::ostream& os = std::cout);
 
 		void LoadTransportGuide(const json::Document& doc, transport_catalogue::TransportCatalogue& guide);
 
@@ -30,17 +32,41 @@ namespace transport_directory {
 
 		void PrintMapToSvg(const renderer::RenderSettings& render_settings, const transport_catalogue::TransportCatalogue& guide, std::ostream& os = std::cout);
 
-		bool SaveDataToFile(const json::Document& doc, const DownloadedDataForTransportRouter& data);
+		// The data of the router is moved out of data while it is saved
+		bool SaveDataToFile(const json::Document& doc, DownloadedDataForTransportRouter&& data);
 
 		DownloadedDataForTransportRouter LoadDataFromFile(const json::Document& doc);
 
 		DownloadedDataForTransportRouter LoadDataFromJson(const json::Document& doc);
 
+		// Catalogue and settings of the base with changes of the document applied
+		DownloadedDataForTransportRouter UpdateDataFromJson(const json::Document& doc, const DownloadedDataForTransportRouter& base);
+
 		namespace detail {
 
 			transport_router::TransportRouter::RoutingSettings LoadRoutingSettings(const json::Document& doc);
 
-			json::Node RequestFindRoute(const json::Dict& request, const transport_router::TransportRouter& router);
+			transport_router::TransportRouter::RouterType LoadRouterType(const json::Node& node);
+			transport_router::TransportRouter::GraphModel LoadGraphModel(const json::Node& node);
+
+			// nullptr, if the document has no route_cache settings
+			std::unique_ptr<transport_router::RouteCache> CreateRouteCache(const json::Document& doc,
+				const transport_catalogue::TransportCatalogue& guide, const transport_router::TransportRouter& router);
+
+			// Fills the cache with routes of Route requests, one JSON request per line
+			void WarmUpRouteCache(std::istream& input, transport_router::RouteCache& route_cache);
+
+			// Overrides of the routing settings in a Route request, nullopt if there are none
+			std::optional<transport_router::TransportRouter::RoutingProfile> LoadRoutingProfile(const json::Dict& request);
+
+			json::Node RequestFindRoute(const json::Dict& request, const transport_router::TransportRouter& router,
+				transport_router::RouteCache* route_cache = nullptr);
+
+			// Total times only, without items of routes
+			json::Node RequestRouteMatrix(const json::Dict& request, const transport_catalogue::TransportCatalogue& guide,
+				const transport_router::TransportRouter& router);
+
+			json::Node RequestRouteCacheStats(const json::Dict& request, const transport_router::RouteCache* route_cache);
 
 			json::Node RequestBusRoute(const json::Dict& request, const transport_catalogue::TransportCatalogue& guide);
 
@@ -80,6 +106,15 @@ namespace transport_directory {
 
 			TransportObject ParseRequestToFillTransportGuide(const json::Node& doc);
 
+			void FillTransportGuide(std::vector<TransportObject>& objects, transport_catalogue::TransportCatalogue& guide);
+
+			// Stops and buses of the catalogue in the order they were added
+			std::vector<TransportObject> GetTransportObjects(const transport_catalogue::TransportCatalogue& guide);
+
+			// Stops and buses of base_requests replace the objects with the same names or are added,
+			// stops and buses of removed_stops and removed_buses are removed
+			void ApplyChangesToObjects(const json::Document& doc, std::vector<TransportObject>& objects);
+
 			svg::Rgba LoadRgba(const json::Node& node);
 			svg::Rgb LoadRgb(const json::Node& node);
 			svg::Color LoadColor(const json::Node& node);
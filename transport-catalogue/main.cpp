@@ -6,7 +6,14 @@
 using namespace std::literals;
 
 void PrintUsage(std::ostream& stream = std::cerr) {
-    stream << "Usage: transport_catalogue [make_base|process_requests]\n"sv;
+    stream << "Usage: transport_catalogue [make_base|update_base|process_requests]\n"sv;
+}
+
+void PrintGraphStats(const transport_directory::transport_router::TransportRouter& router, std::ostream& stream = std::clog) {
+    if (router.GetPrunedEdgeCount() > 0) {
+        stream << "Dominated bus edges removed: "sv << router.GetPrunedEdgeCount()
+            << ", edges left: "sv << router.GetGraph().GetEdgeCount() << '\n';
+    }
 }
 
 int main(int argc, char* argv[]) {
@@ -23,15 +30,32 @@ int main(int argc, char* argv[]) {
         json::Document doc(json::Load(std::cin));
         transport_directory::json_reader::DownloadedDataForTransportRouter data = transport_directory::json_reader::LoadDataFromJson(doc);
         transport_directory::transport_router::TransportRouter router(data.guide, data.routing_settings);
-        data.data_for_router = std::make_unique<transport_directory::transport_router::TransportRouter::DownloadedData>(router.GetDataForTransRouter());
-        transport_directory::json_reader::SaveDataToFile(doc, data);
+        PrintGraphStats(router);
+        data.data_for_router = std::make_unique<transport_directory::transport_router::TransportRouter::DownloadedData>(router.ReleaseDataForTransRouter());
+        transport_directory::json_reader::SaveDataToFile(doc, std::move(data));
+    }
+    else if (mode == "update_base"sv) {
+
+        // apply changes to the base, only routes the changes affect are recomputed
+        json::Document doc(json::Load(std::cin));
+        transport_directory::json_reader::DownloadedDataForTransportRouter base = transport_directory::json_reader::LoadDataFromFile(doc);
+        if (!base.data_for_router) {
+            std::cerr << "Can't load the base to update\n"sv;
+            return 1;
+        }
+        transport_directory::transport_router::TransportRouter previous_router(base.guide, base.routing_settings, std::move(*base.data_for_router));
+        transport_directory::json_reader::DownloadedDataForTransportRouter data = transport_directory::json_reader::UpdateDataFromJson(doc, base);
+        transport_directory::transport_router::TransportRouter router(data.guide, data.routing_settings, previous_router);
+        PrintGraphStats(router);
+        data.data_for_router = std::make_unique<transport_directory::transport_router::TransportRouter::DownloadedData>(router.ReleaseDataForTransRouter());
+        transport_directory::json_reader::SaveDataToFile(doc, std::move(data));
     }
     else if (mode == "process_requests"sv) {
 
         // process requests here
         json::Document doc(json::Load(std::cin));
         transport_directory::json_reader::DownloadedDataForTransportRouter data = transport_directory::json_reader::LoadDataFromFile(doc);
-        transport_directory::json_reader::PrintAnswearsForRequests(doc, data);
+        transport_directory::json_reader::PrintAnswearsForRequests(doc, std::move(data));
     }
     else {
         PrintUsage();
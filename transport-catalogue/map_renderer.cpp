@@ -18,15 +18,15 @@ namespace renderer {
 	}
 
     RenderNameOfRoutes::RenderNameOfRoutes(const svg::Point& pos, const svg::Point& offset, int font_size,
-        const std::string& name_bus, svg::Color underlayer_color, double underlayer_width, svg::Color text_color) {
+        std::string_view name_bus, svg::Color underlayer_color, double underlayer_width, svg::Color text_color) {
         using namespace std::literals;
         underlayer_.SetPosition(pos).SetOffset(offset).SetFontSize(font_size)
-            .SetFontFamily("Verdana"s).SetFontWeight("bold"s).SetData(name_bus)
+            .SetFontFamily("Verdana"s).SetFontWeight("bold"s).SetData(std::string(name_bus))
             .SetFillColor(underlayer_color).SetStrokeColor(underlayer_color)
             .SetStrokeWidth(underlayer_width).SetStrokeLineCap(svg::StrokeLineCap::ROUND)
             .SetStrokeLineJoin(svg::StrokeLineJoin::ROUND);
         text_.SetPosition(pos).SetOffset(offset).SetFontSize(font_size)
-            .SetFontFamily("Verdana"s).SetFontWeight("bold"s).SetData(name_bus)
+            .SetFontFamily("Verdana"s).SetFontWeight("bold"s).SetData(std::string(name_bus))
             .SetFillColor(text_color);
     }
 
@@ -45,15 +45,15 @@ namespace renderer {
     }
 
     RenderNameOfStops::RenderNameOfStops(const svg::Point& pos, const svg::Point& offset, int font_size,
-        const std::string& name_stop, svg::Color underlayer_color, double underlayer_width) {
+        std::string_view name_stop, svg::Color underlayer_color, double underlayer_width) {
         using namespace std::literals;
         underlayer_.SetPosition(pos).SetOffset(offset).SetFontSize(font_size)
-            .SetFontFamily("Verdana"s).SetData(name_stop)
+            .SetFontFamily("Verdana"s).SetData(std::string(name_stop))
             .SetFillColor(underlayer_color).SetStrokeColor(underlayer_color)
             .SetStrokeWidth(underlayer_width).SetStrokeLineCap(svg::StrokeLineCap::ROUND)
             .SetStrokeLineJoin(svg::StrokeLineJoin::ROUND);
         text_.SetPosition(pos).SetOffset(offset).SetFontSize(font_size)
-            .SetFontFamily("Verdana"s).SetData(name_stop)
+            .SetFontFamily("Verdana"s).SetData(std::string(name_stop))
             .SetFillColor("black"s);
     }
 
@@ -7,6 +7,7 @@
 #include <cstdlib>
 #include <iostream>
 #include <optional>
+#include <string_view>
 #include <vector>
 #include <memory>
 
@@ -43,7 +44,7 @@ namespace renderer {
     class RenderNameOfRoutes : public svg::Drawable {
     public:
         RenderNameOfRoutes(const svg::Point& pos, const svg::Point& offset, int font_size,
-            const std::string& name_bus, svg::Color underlayer_color, double underlayer_width, svg::Color text_color);
+            std::string_view name_bus, svg::Color underlayer_color, double underlayer_width, svg::Color text_color);
 
         void Draw(svg::ObjectContainer& container) const override;
 
@@ -65,7 +66,7 @@ namespace renderer {
     class RenderNameOfStops : public svg::Drawable {
     public:
         RenderNameOfStops(const svg::Point& pos, const svg::Point& offset, int font_size,
-            const std::string& name_stop, svg::Color underlayer_color, double underlayer_width);
+            std::string_view name_stop, svg::Color underlayer_color, double underlayer_width);
 
         void Draw(svg::ObjectContainer& container) const override;
 
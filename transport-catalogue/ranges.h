@@ -1,4 +1,6 @@
 #pragma once
+#include <cstddef>
+#include <iterator>
 
 namespace ranges {
 
@@ -17,6 +19,15 @@ namespace ranges {
         It end() const {
             return end_;
         }
+        size_t size() const {
+            return static_cast<size_t>(std::distance(begin_, end_));
+        }
+        bool empty() const {
+            return begin_ == end_;
+        }
+        decltype(auto) operator[](size_t index) const {
+            return begin_[index];
+        }
 
     private:
         It begin_;
@@ -28,4 +39,4 @@ namespace ranges {
         return Range{ container.begin(), container.end() };
     }
 
-}  // namespace ranges
\ No newline at end of file
+}  // namespace ranges
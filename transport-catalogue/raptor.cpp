@@ -0,0 +1,218 @@
+#include "raptor.h"
+
+#include <algorithm>
+#include <numeric>
+#include <stdexcept>
+#include <string>
+
+namespace transport_directory {
+
+	namespace transport_router {
+
+		//-----------------------------class Raptor -------------------------------------------------
+
+		Raptor::Raptor(const transport_catalogue::TransportCatalogue& guide, const TransportRouter::RoutingSettings& routing_settings)
+			: guide_(guide)
+			, bus_velocity_(routing_settings.bus_velocity)
+		{
+			for (const auto& stop : guide.GetStops()) {
+				stops_.push_back(&stop);
+			}
+			is_closed_.assign(stops_.size(), 0);
+			for (const std::string& name : routing_settings.closed_stops) {
+				if (const domain::Stop* stop = guide.SearchStop(name)) {
+					is_closed_[stop->id] = 1;
+				}
+			}
+			route_offsets_.push_back(0);
+			for (const auto& bus_route : guide.GetBusRoutes()) {
+				const std::vector<int64_t> distances = TransportRouter::ComputeRouteDistances(guide, bus_route.route);
+				for (size_t i = 0; i < bus_route.route.size(); ++i) {
+					route_stops_.push_back(bus_route.route[i]->id);
+					route_distances_.push_back(distances[i]);
+					position_buses_.push_back(static_cast<uint32_t>(buses_.size()));
+				}
+				buses_.push_back(&bus_route);
+				route_offsets_.push_back(static_cast<uint32_t>(route_stops_.size()));
+			}
+			default_costs_.bus_wait_time = MinutesToWeight(static_cast<double>(routing_settings.bus_wait_time));
+			default_costs_.bus_velocities.assign(buses_.size(), bus_velocity_);
+
+			// positions are grouped by stops with a counting sort
+			stop_position_offsets_.assign(stops_.size() + 1, 0);
+			for (const uint32_t stop : route_stops_) {
+				++stop_position_offsets_[stop + 1];
+			}
+			std::partial_sum(stop_position_offsets_.begin(), stop_position_offsets_.end(), stop_position_offsets_.begin());
+			std::vector<uint32_t> next_positions(stop_position_offsets_.begin(), stop_position_offsets_.end() - 1);
+			stop_positions_.resize(route_stops_.size());
+			for (uint32_t position = 0; position < route_stops_.size(); ++position) {
+				stop_positions_[next_positions[route_stops_[position]]++] = position;
+			}
+		}
+
+		std::optional<TransportRouter::RouteInfo> Raptor::BuildRoute(const domain::Stop* from, const domain::Stop* to, size_t max_transfers) const {
+			return BuildRoute(from, to, max_transfers, default_costs_);
+		}
+
+		std::optional<TransportRouter::RouteInfo> Raptor::BuildRoute(const domain::Stop* from, const domain::Stop* to,
+			const TransportRouter::RoutingProfile& profile) const {
+			return BuildRoute(from, to, profile.max_transfers.value_or(UNLIMITED_TRANSFERS), MakeCosts(profile));
+		}
+
+		Raptor::Costs Raptor::MakeCosts(const TransportRouter::RoutingProfile& profile) const {
+			using namespace std::literals;
+			Costs costs;
+			costs.bus_wait_time = profile.bus_wait_time ? MinutesToWeight(static_cast<double>(*profile.bus_wait_time)) : default_costs_.bus_wait_time;
+			const double bus_velocity = profile.bus_velocity.value_or(bus_velocity_);
+			if (!(bus_velocity > 0)) {
+				throw std::invalid_argument("Bus velocity should be positive"s);
+			}
+			costs.bus_velocities.assign(buses_.size(), bus_velocity);
+			for (const auto& [name, factor] : profile.bus_speed_factors) {
+				if (!(factor > 0)) {
+					throw std::invalid_argument("Speed factor of bus "s + name + " should be positive"s);
+				}
+				if (const domain::BusRoute* bus = guide_.SearchRoute(name)) {
+					costs.bus_velocities[bus->id] = bus_velocity * factor;
+				}
+			}
+			return costs;
+		}
+
+		std::optional<TransportRouter::RouteInfo> Raptor::BuildRoute(const domain::Stop* from, const domain::Stop* to, size_t max_transfers,
+			const Costs& costs) const {
+			const uint32_t from_index = GetStopIndex(from);
+			const uint32_t to_index = GetStopIndex(to);
+			if (from_index == NO_STOP || to_index == NO_STOP) {
+				return std::nullopt;
+			}
+			if (from_index == to_index) {
+				return TransportRouter::RouteInfo{};
+			}
+			std::vector<Weight> best_weights;
+			const Rounds rounds = Search(from_index, to_index, max_transfers, costs, best_weights);
+			if (best_weights[to_index] == UNREACHABLE_WEIGHT) {
+				return std::nullopt;
+			}
+			return RestoreRoute(rounds, to_index, best_weights[to_index], costs);
+		}
+
+		std::vector<std::optional<Weight>> Raptor::ComputeRouteWeights(const domain::Stop* from, const std::vector<const domain::Stop*>& to,
+			size_t max_transfers) const {
+			std::vector<std::optional<Weight>> weights(to.size());
+			const uint32_t from_index = GetStopIndex(from);
+			if (from_index == NO_STOP) {
+				return weights;
+			}
+			std::vector<Weight> best_weights;
+			Search(from_index, NO_STOP, max_transfers, default_costs_, best_weights);
+			for (size_t i = 0; i < to.size(); ++i) {
+				const uint32_t to_index = GetStopIndex(to[i]);
+				if (to_index != NO_STOP && best_weights[to_index] != UNREACHABLE_WEIGHT) {
+					weights[i] = best_weights[to_index];
+				}
+			}
+			return weights;
+		}
+
+		uint32_t Raptor::GetStopIndex(const domain::Stop* stop) const {
+			if (!stop || stop->id >= stops_.size() || stop_position_offsets_[stop->id] == stop_position_offsets_[stop->id + 1]) {
+				return NO_STOP;// stops without buses aren't routed, as in the graph
+			}
+			return stop->id;
+		}
+
+		Raptor::Rounds Raptor::Search(uint32_t from, uint32_t target, size_t max_transfers, const Costs& costs,
+			std::vector<Weight>& best_weights) const {
+			const size_t stop_count = stops_.size();
+			const size_t max_round = max_transfers == UNLIMITED_TRANSFERS ? UNLIMITED_TRANSFERS : max_transfers + 1;
+			best_weights.assign(stop_count, UNREACHABLE_WEIGHT);
+			best_weights[from] = Weight{};
+			Rounds rounds(1, std::vector<Label>(stop_count));
+			rounds[0][from].weight = Weight{};
+
+			std::vector<uint32_t> marked_stops{ from };
+			std::vector<char> is_marked(stop_count, 0);
+			std::vector<uint32_t> first_positions(buses_.size(), NO_POSITION);
+			std::vector<uint32_t> scanned_buses;
+			std::vector<Weight> previous_weights;
+			for (size_t round = 1; round <= max_round && !marked_stops.empty(); ++round) {
+				// every bus is scanned from its first position at a stop improved in the previous round
+				for (const uint32_t stop : marked_stops) {
+					for (uint32_t i = stop_position_offsets_[stop]; i < stop_position_offsets_[stop + 1]; ++i) {
+						const uint32_t position = stop_positions_[i];
+						const uint32_t bus = position_buses_[position];
+						if (first_positions[bus] == NO_POSITION) {
+							scanned_buses.push_back(bus);
+						}
+						first_positions[bus] = std::min(first_positions[bus], position);
+					}
+					is_marked[stop] = 0;
+				}
+				marked_stops.clear();
+				std::sort(scanned_buses.begin(), scanned_buses.end());
+
+				// buses are boarded at the weights of the previous round, so a round adds one bus to routes
+				previous_weights = best_weights;
+				std::vector<Label>& labels = rounds.emplace_back(stop_count);
+				for (const uint32_t bus : scanned_buses) {
+					uint32_t board = NO_POSITION;
+					Weight board_weight = UNREACHABLE_WEIGHT;
+					for (uint32_t position = first_positions[bus]; position < route_offsets_[bus + 1]; ++position) {
+						const uint32_t stop = route_stops_[position];
+						Weight weight = UNREACHABLE_WEIGHT;
+						if (board != NO_POSITION && !is_closed_[stop]) {
+							weight = board_weight + TransportRouter::ComputeWeightForDistance(
+								route_distances_[position] - route_distances_[board], costs.bus_velocities[bus]);
+							const Weight bound = target == NO_STOP ? best_weights[stop] : std::min(best_weights[stop], best_weights[target]);
+							if (weight < bound) {
+								best_weights[stop] = weight;
+								labels[stop] = Label{ weight, bus, board, position };
+								if (!is_marked[stop]) {
+									is_marked[stop] = 1;
+									marked_stops.push_back(stop);
+								}
+							}
+						}
+						// boarding here again is better only if the stop was reached earlier by other buses
+						const Weight wait_end_weight = graph::AddWeights(previous_weights[stop], costs.bus_wait_time);
+						if (!is_closed_[stop] && wait_end_weight < weight) {
+							board = position;
+							board_weight = wait_end_weight;
+						}
+					}
+					first_positions[bus] = NO_POSITION;
+				}
+				scanned_buses.clear();
+			}
+			return rounds;
+		}
+
+		TransportRouter::RouteInfo Raptor::RestoreRoute(const Rounds& rounds, uint32_t to, Weight weight, const Costs& costs) const {
+			std::vector<TransportRouter::DataEdge> edges;
+			uint32_t stop = to;
+			size_t round = rounds.size() - 1;
+			while (true) {
+				// the last round that improved the stop holds its best weight
+				while (rounds[round][stop].weight == UNREACHABLE_WEIGHT) {
+					--round;
+				}
+				if (round == 0) {
+					break;
+				}
+				const Label& label = rounds[round][stop];
+				const Weight ride_weight = TransportRouter::ComputeWeightForDistance(
+					route_distances_[label.alight] - route_distances_[label.board], costs.bus_velocities[label.bus]);
+				edges.push_back(TransportRouter::DataEdge{ ride_weight, buses_[label.bus], static_cast<int>(label.alight - label.board) - 1 });
+				stop = route_stops_[label.board];
+				edges.push_back(TransportRouter::DataEdge{ costs.bus_wait_time, stops_[stop], 0 });
+				--round;
+			}
+			std::reverse(edges.begin(), edges.end());
+			return TransportRouter::RouteInfo{ weight, std::move(edges) };
+		}
+
+	}// namespace transport_router
+
+}// namespace transport_directory
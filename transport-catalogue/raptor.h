@@ -0,0 +1,92 @@
+#pragma once
+#include "transport_catalogue.h"
+#include "transport_router.h"
+#include "domain.h"
+
+#include <cstdint>
+#include <limits>
+#include <optional>
+#include <vector>
+
+namespace transport_directory {
+
+	namespace transport_router {
+
+		// Round-based search (RAPTOR) over stop sequences of buses without a graph.
+		// Round k finds the best routes with k buses: every bus that passes a stop improved
+		// in the previous round is scanned once along its stops
+		class Raptor {
+		public:
+			static constexpr size_t UNLIMITED_TRANSFERS = std::numeric_limits<size_t>::max();
+
+			Raptor(const transport_catalogue::TransportCatalogue& guide, const TransportRouter::RoutingSettings& routing_settings);
+
+			std::optional<TransportRouter::RouteInfo> BuildRoute(const domain::Stop* from, const domain::Stop* to,
+				size_t max_transfers = UNLIMITED_TRANSFERS) const;
+
+			// Weights of the profile are computed from the road distances while buses are scanned
+			std::optional<TransportRouter::RouteInfo> BuildRoute(const domain::Stop* from, const domain::Stop* to,
+				const TransportRouter::RoutingProfile& profile) const;
+
+			// Weights of the best routes from the stop to every stop of to, nullopt if there is no route
+			std::vector<std::optional<Weight>> ComputeRouteWeights(const domain::Stop* from, const std::vector<const domain::Stop*>& to,
+				size_t max_transfers = UNLIMITED_TRANSFERS) const;
+
+		private:
+			static constexpr uint32_t NO_STOP = std::numeric_limits<uint32_t>::max();
+			static constexpr uint32_t NO_POSITION = std::numeric_limits<uint32_t>::max();
+			static constexpr Weight UNREACHABLE_WEIGHT = std::numeric_limits<Weight>::has_infinity
+				? std::numeric_limits<Weight>::infinity() : std::numeric_limits<Weight>::max();
+
+			// How a stop is reached in a round: by the bus from position board to position alight of its route
+			struct Label {
+				Weight weight = UNREACHABLE_WEIGHT;
+				uint32_t bus = 0;
+				uint32_t board = NO_POSITION;
+				uint32_t alight = NO_POSITION;
+			};
+
+			// Labels of every round, the round 0 holds the start stop only
+			using Rounds = std::vector<std::vector<Label>>;
+
+			// Weights of waiting for a bus and velocities of every bus a search uses
+			struct Costs {
+				Weight bus_wait_time;
+				std::vector<double> bus_velocities;// km/h
+			};
+
+			Costs MakeCosts(const TransportRouter::RoutingProfile& profile) const;
+
+			std::optional<TransportRouter::RouteInfo> BuildRoute(const domain::Stop* from, const domain::Stop* to,
+				size_t max_transfers, const Costs& costs) const;
+
+			// NO_STOP for unknown stops and stops without buses
+			uint32_t GetStopIndex(const domain::Stop* stop) const;
+
+			// Runs rounds until nothing improves or max_transfers is reached; routes to the target stop
+			// are pruned by its best weight, NO_STOP searches for routes to all stops
+			Rounds Search(uint32_t from, uint32_t target, size_t max_transfers, const Costs& costs, std::vector<Weight>& best_weights) const;
+
+			// Items of the route to the stop, the rounds are walked back from the last one
+			TransportRouter::RouteInfo RestoreRoute(const Rounds& rounds, uint32_t to, Weight weight, const Costs& costs) const;
+
+			// stops and buses are indexed by their ids in the catalogue
+			const transport_catalogue::TransportCatalogue& guide_;
+			double bus_velocity_;
+			Costs default_costs_;// of the routing settings
+			std::vector<const domain::Stop*> stops_;
+			std::vector<char> is_closed_;// buses aren't boarded and left at closed stops
+			std::vector<const domain::BusRoute*> buses_;
+			// stops of bus b take positions [route_offsets_[b], route_offsets_[b + 1]) of the arrays below
+			std::vector<uint32_t> route_offsets_;
+			std::vector<uint32_t> route_stops_;
+			std::vector<int64_t> route_distances_;// meters from the first stop of the bus
+			// positions of buses at stop s take [stop_position_offsets_[s], stop_position_offsets_[s + 1]) of stop_positions_
+			std::vector<uint32_t> stop_position_offsets_;
+			std::vector<uint32_t> stop_positions_;
+			std::vector<uint32_t> position_buses_;// bus of every position of route_stops_
+		};
+
+	}// namespace transport_router
+
+}// namespace transport_directory
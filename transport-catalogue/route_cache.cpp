@@ -0,0 +1,107 @@
+#include "route_cache.h"
+
+#include <algorithm>
+#include <cstdint>
+
+namespace transport_directory {
+
+	namespace transport_router {
+
+		//-----------------------------class RouteCache -------------------------------------------------
+
+		RouteCache::RouteCache(const transport_catalogue::TransportCatalogue& guide, const TransportRouter& router,
+			size_t capacity, size_t shard_count)
+			: guide_(guide)
+			, router_(router)
+			, shards_(std::max<size_t>(shard_count, 1))
+		{
+			for (size_t i = 0; i < shards_.size(); ++i) {
+				shards_[i].capacity = capacity / shards_.size() + (i < capacity % shards_.size() ? 1 : 0);
+			}
+		}
+
+		std::shared_ptr<const TransportRouter::RouteInfo> RouteCache::BuildRoute(std::string_view from, std::string_view to) {
+			return BuildRoute(from, to, true);
+		}
+
+		void RouteCache::Preload(std::string_view from, std::string_view to) {
+			BuildRoute(from, to, false);
+		}
+
+		RouteCache::Stats RouteCache::GetStats() const {
+			Stats stats;
+			stats.hit_count = hit_count_;
+			stats.miss_count = miss_count_;
+			for (const Shard& shard : shards_) {
+				std::lock_guard lock(shard.mutex);
+				stats.size += shard.entries.size();
+			}
+			return stats;
+		}
+
+		std::shared_ptr<const TransportRouter::RouteInfo> RouteCache::BuildRoute(std::string_view from, std::string_view to, bool count_stats) {
+			const domain::Stop* from_stop = guide_.SearchStop(from);
+			const domain::Stop* to_stop = guide_.SearchStop(to);
+			if (!from_stop || !to_stop) {
+				return nullptr;
+			}
+			const Key key = static_cast<uint64_t>(from_stop->id) << 32 | to_stop->id;
+			Shard& shard = GetShard(key);
+			{
+				std::lock_guard lock(shard.mutex);
+				if (auto it = shard.index.find(key); it != shard.index.end()) {
+					shard.entries.splice(shard.entries.begin(), shard.entries, it->second);
+					if (count_stats) {
+						++hit_count_;
+					}
+					return it->second->second;
+				}
+			}
+			if (count_stats) {
+				++miss_count_;
+			}
+			// the route is built without the lock, so other requests to the shard aren't blocked
+			Value value;
+			if (auto route_info = router_.BuildRoute(from_stop, to_stop)) {
+				value = std::make_shared<const TransportRouter::RouteInfo>(std::move(*route_info));
+			}
+			std::lock_guard lock(shard.mutex);
+			Insert(shard, key, value);
+			return value;
+		}
+
+		size_t RouteCache::KeyHasher::operator()(Key key) const {
+			// finalizer of SplitMix64
+			key ^= key >> 30;
+			key *= 0xBF58476D1CE4E5B9ull;
+			key ^= key >> 27;
+			key *= 0x94D049BB133111EBull;
+			key ^= key >> 31;
+			return static_cast<size_t>(key);
+		}
+
+		RouteCache::Shard& RouteCache::GetShard(Key key) {
+			// buckets of a shard are taken by the hash modulo their count, shards by its high bits
+			return shards_[(static_cast<uint64_t>(KeyHasher{}(key)) >> 32) % shards_.size()];
+		}
+
+		void RouteCache::Insert(Shard& shard, Key key, Value value) {
+			if (shard.capacity == 0) {
+				return;
+			}
+			if (auto it = shard.index.find(key); it != shard.index.end()) {
+				it->second->second = std::move(value);
+				shard.entries.splice(shard.entries.begin(), shard.entries, it->second);
+				return;
+			}
+			if (shard.entries.size() == shard.capacity) {
+				shard.index.erase(shard.entries.back().first);
+				shard.entries.pop_back();
+			}
+			shard.entries.emplace_front(key, std::move(value));
+			shard.index.emplace(key, shard.entries.begin());
+		}
+
+	}// namespace transport_router
+
+}// namespace transport_directory
@@ -0,0 +1,74 @@
+#pragma once
+#include "transport_catalogue.h"
+#include "transport_router.h"
+#include "domain.h"
+
+#include <atomic>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace transport_directory {
+
+	namespace transport_router {
+
+		// Bounded cache of built routes between pairs of stops.
+		// The cache is split into shards with their own locks and eviction of the least recently used routes
+		class RouteCache {
+		public:
+			struct Stats {
+				size_t hit_count = 0;
+				size_t miss_count = 0;
+				size_t size = 0;
+			};
+
+			static constexpr size_t DEFAULT_SHARD_COUNT = 16;
+
+			RouteCache(const transport_catalogue::TransportCatalogue& guide, const TransportRouter& router,
+				size_t capacity, size_t shard_count = DEFAULT_SHARD_COUNT);
+
+			// nullptr, if there is no route
+			std::shared_ptr<const TransportRouter::RouteInfo> BuildRoute(std::string_view from, std::string_view to);
+
+			// Puts the route into the cache without counting hits and misses
+			void Preload(std::string_view from, std::string_view to);
+
+			Stats GetStats() const;
+
+		private:
+			using Key = uint64_t;// ids of the stops from and to
+			using Value = std::shared_ptr<const TransportRouter::RouteInfo>;
+
+			// Mixes all bits of the ids, so both shards and buckets of a shard are taken from a uniform hash
+			struct KeyHasher {
+				size_t operator()(Key key) const;
+			};
+
+			struct Shard {
+				mutable std::mutex mutex;
+				size_t capacity = 0;
+				std::list<std::pair<Key, Value>> entries;// the most recently used go first
+				std::unordered_map<Key, std::list<std::pair<Key, Value>>::iterator, KeyHasher> index;
+			};
+
+			std::shared_ptr<const TransportRouter::RouteInfo> BuildRoute(std::string_view from, std::string_view to, bool count_stats);
+
+			Shard& GetShard(Key key);
+
+			void Insert(Shard& shard, Key key, Value value);
+
+			const transport_catalogue::TransportCatalogue& guide_;
+			const TransportRouter& router_;
+			std::vector<Shard> shards_;
+			std::atomic<size_t> hit_count_{ 0 };
+			std::atomic<size_t> miss_count_{ 0 };
+		};
+
+	}// namespace transport_router
+
+}// namespace transport_directory
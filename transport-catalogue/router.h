@@ -1,10 +1,17 @@
 #pragma once
 #include "graph.h"
+#include "huge_page_allocator.h"
+#include "router_engine.h"
+#include "search_space.h"
+#include "thread_pool.h"
 
 #include <algorithm>
 #include <cassert>
+#include <cmath>
 #include <cstdint>
 #include <iterator>
+#include <limits>
+#include <numeric>
 #include <optional>
 #include <stdexcept>
 #include <unordered_map>
@@ -14,87 +21,609 @@
 namespace graph {
 
     template <typename Weight>
-    class Router {
+    class Router : public RouterEngine<Weight> {
     private:
         using Graph = DirectedWeightedGraph<Weight>;
 
     public:
-        struct RouteInternalData {
-            Weight weight;
-            std::optional<EdgeId> prev_edge;
+        using typename RouterEngine<Weight>::RouteInfo;
+
+        // Матрица кратчайших маршрутов из вершин-источников, хранящаяся построчно
+        // в двух плоских массивах: веса маршрутов и id последних рёбер маршрутов.
+        // Столбцы есть только у источников и у вершин, в которые входит не одно ребро:
+        // маршрут до остальных вершин продолжает маршрут до начала их единственного входящего ребра
+        struct RoutesInternalData {
+            size_t vertex_count = 0;
+            std::vector<uint32_t> rows;// источники по возрастанию id
+            std::vector<Weight, memory::HugePageAllocator<Weight>> weights;// UNREACHABLE_WEIGHT, если маршрута нет
+            std::vector<uint32_t, memory::HugePageAllocator<uint32_t>> prev_edges;// NO_PREV_EDGE для пустого маршрута
         };
-        using RoutesInternalData = std::vector<std::vector<std::optional<RouteInternalData>>>;
 
-        explicit Router(const Graph& graph);
+        static constexpr Weight UNREACHABLE_WEIGHT = std::numeric_limits<Weight>::has_infinity
+            ? std::numeric_limits<Weight>::infinity() : std::numeric_limits<Weight>::max();
+        static constexpr uint32_t NO_PREV_EDGE = std::numeric_limits<uint32_t>::max();
+        static constexpr VertexId NO_VERTEX = std::numeric_limits<VertexId>::max();
+        static constexpr EdgeId NO_EDGE = detail::NO_EDGE;
+
+        // Маршруты из всех вершин. thread_count == 0 означает число аппаратных потоков
+        explicit Router(const Graph& graph, size_t thread_count = 1);
+
+        // Маршруты только из вершин sources, строка каждой из них рассчитывается поиском Дейкстры;
+        // потоки берут строки по одной, у каждого потока свои куча и массивы поиска.
+        // Если источники - все вершины, а граф плотный, таблица рассчитывается алгоритмом Флойда-Уоршелла.
+        // Маршруты из остальных вершин не строятся
+        Router(const Graph& graph, std::vector<VertexId> sources, size_t thread_count = 1);
+
+        // Обновляет таблицу previous_data прежнего графа previous_graph после изменения графа.
+        // vertex_map и edge_map переводят id вершин и рёбер прежнего графа в id нового графа;
+        // NO_VERTEX и NO_EDGE отмечают удалённые вершины и рёбра, а также рёбра, у которых изменились концы или вес.
+        // Алгоритмом Дейкстры заново рассчитываются только строки, маршруты которых проходили по удалённым рёбрам
+        // или могут улучшиться через новые рёбра, остальные строки переносятся из прежней таблицы.
+        // Если таблица строится для всех вершин и затронута большая часть строк,
+        // она рассчитывается заново алгоритмом Флойда-Уоршелла
+        Router(const Graph& graph, std::vector<VertexId> sources, const Graph& previous_graph, const RoutesInternalData& previous_data,
+            const std::vector<VertexId>& vertex_map, const std::vector<EdgeId>& edge_map, size_t thread_count = 1);
 
         Router(const Graph& graph, RoutesInternalData routes_internal_data);
 
-        struct RouteInfo {
-            Weight weight;
-            std::vector<EdgeId> edges;
-        };
+        // from должна быть источником таблицы
+        std::optional<RouteInfo> BuildRoute(VertexId from, VertexId to) const override;
 
-        std::optional<RouteInfo> BuildRoute(VertexId from, VertexId to) const;
+        std::optional<Weight> ComputeRouteWeight(VertexId from, VertexId to) const override;
 
         const RoutesInternalData& GetData() const;
 
+        // Отдаёт таблицу маршрутов без копирования; после этого маршрутизатор можно только разрушить
+        RoutesInternalData ReleaseData();
+
     private:
+        static constexpr uint32_t NO_INDEX = std::numeric_limits<uint32_t>::max();
+
+        // Расположение вершин в таблице: индексы строк и столбцов (NO_INDEX, если их нет)
+        // и для вершин без столбца - id единственного входящего ребра
+        struct TableLayout {
+            std::vector<uint32_t> row_indexes;
+            std::vector<uint32_t> column_indexes;
+            std::vector<uint32_t> columns;// id вершин столбцов
+            std::vector<uint32_t> chain_edges;// NO_PREV_EDGE для вершин со столбцом
+        };
+
+        // Вершины с одним входящим ребром остаются без столбца, если они не источники
+        // и цепочка входящих рёбер от них приводит к вершине со столбцом, а не замыкается в цикл
+        static TableLayout MakeLayout(const Graph& graph, const std::vector<uint32_t>& rows);
+
+        // Вес маршрута из источника строки row до вершины to и id его последнего ребра.
+        // Веса рёбер цепочки складываются в порядке маршрута, как при поиске Дейкстры
+        static std::pair<Weight, uint32_t> FindRouteEnd(const Graph& graph, const RoutesInternalData& data,
+            const TableLayout& layout, size_t row, VertexId to);
+
+        static std::vector<uint32_t> MakeRows(std::vector<VertexId> sources, size_t vertex_count);
 
+        static std::vector<VertexId> ListVertices(size_t vertex_count);
+
+        static void CheckEdges(const Graph& graph);
+
+        // Таблица без маршрутов для строк и столбцов layout_
+        void AllocateRoutesInternalData();
+
+        bool HasAllRows() const {
+            return routes_internal_data_.rows.size() == routes_internal_data_.vertex_count;
+        }
+
+        // Начальная таблица алгоритма Флойда-Уоршелла, строки и столбцы которой - все вершины
         void InitializeRoutesInternalData(const Graph& graph) {
             const size_t vertex_count = graph.GetVertexCount();
+            if (graph.GetEdgeCount() >= NO_PREV_EDGE) {
+                throw std::length_error("Too many edges for 32-bit edge ids");
+            }
+            routes_internal_data_.weights.assign(vertex_count * vertex_count, UNREACHABLE_WEIGHT);
+            routes_internal_data_.prev_edges.assign(vertex_count * vertex_count, NO_PREV_EDGE);
             for (VertexId vertex = 0; vertex < vertex_count; ++vertex) {
-                routes_internal_data_[vertex][vertex] = RouteInternalData{ ZERO_WEIGHT, std::nullopt };
+                Weight* weights = &routes_internal_data_.weights[vertex * vertex_count];
+                uint32_t* prev_edges = &routes_internal_data_.prev_edges[vertex * vertex_count];
+                weights[vertex] = ZERO_WEIGHT;
                 for (const EdgeId edge_id : graph.GetIncidentEdges(vertex)) {
                     const auto& edge = graph.GetEdge(edge_id);
                     if (edge.weight < ZERO_WEIGHT) {
                         throw std::domain_error("Edges' weights should be non-negative");
                     }
-                    auto& route_internal_data = routes_internal_data_[vertex][edge.to];
-                    if (!route_internal_data || route_internal_data->weight > edge.weight) {
-                        route_internal_data = RouteInternalData{ edge.weight, edge_id };
+                    if (edge.weight < weights[edge.to]) {
+                        weights[edge.to] = edge.weight;
+                        prev_edges[edge.to] = static_cast<uint32_t>(edge_id);
                     }
                 }
             }
         }
 
-        void RelaxRoute(VertexId vertex_from, VertexId vertex_to, const RouteInternalData& route_from,
-            const RouteInternalData& route_to) {
-            auto& route_relaxing = routes_internal_data_[vertex_from][vertex_to];
-            const Weight candidate_weight = route_from.weight + route_to.weight;
-            if (!route_relaxing || candidate_weight < route_relaxing->weight) {
-                route_relaxing = { candidate_weight,
-                                  route_to.prev_edge ? route_to.prev_edge : route_from.prev_edge };
+        // Min-plus ядро: ослабляет маршруты строки на отрезке [begin, end) через вершину,
+        // до которой ведёт маршрут веса weight_through с последним ребром prev_edge_through.
+        // Ветвлений в цикле нет, поэтому компилятор может его векторизовать
+        static void RelaxRow(Weight weight_through, uint32_t prev_edge_through,
+            const Weight* weights_via, const uint32_t* prev_edges_via,
+            Weight* weights, uint32_t* prev_edges, size_t begin, size_t end) {
+            for (size_t vertex_to = begin; vertex_to < end; ++vertex_to) {
+                const Weight candidate_weight = AddWeights(weight_through, weights_via[vertex_to]);
+                const bool is_better = candidate_weight < weights[vertex_to];
+                const uint32_t prev_edge = prev_edges_via[vertex_to] != NO_PREV_EDGE
+                    ? prev_edges_via[vertex_to] : prev_edge_through;
+                weights[vertex_to] = is_better ? candidate_weight : weights[vertex_to];
+                prev_edges[vertex_to] = is_better ? prev_edge : prev_edges[vertex_to];
             }
         }
 
-        void RelaxRoutesInternalDataThroughVertex(size_t vertex_count, VertexId vertex_through) {
-            for (VertexId vertex_from = 0; vertex_from < vertex_count; ++vertex_from) {
-                if (const auto& route_from = routes_internal_data_[vertex_from][vertex_through]) {
-                    for (VertexId vertex_to = 0; vertex_to < vertex_count; ++vertex_to) {
-                        if (const auto& route_to = routes_internal_data_[vertex_through][vertex_to]) {
-                            RelaxRoute(vertex_from, vertex_to, *route_from, *route_to);
-                        }
-                    }
-                }
-            }
-        }
+        // Алгоритм Флойда-Уоршелла по блокам из BLOCK_SIZE промежуточных вершин.
+        // Для каждой промежуточной вершины k запоминается строка k в том виде, в каком её видит
+        // последовательный алгоритм на шаге k, а для каждой строки - её элемент в столбце k.
+        // После этого строки блоками обрабатываются независимо и в каждой ячейке выполняются
+        // те же операции в том же порядке, что и в последовательном алгоритме,
+        // поэтому результат побитово совпадает при любом числе потоков
+        void ComputeRoutesInternalData(size_t thread_count);
 
+        // Доводит строки блока промежуточных вершин до шага, на котором каждая из них
+        // становится промежуточной, и запоминает их
+        void PreparePivotRows(VertexId pivot_begin, VertexId pivot_end);
+
+        // Ослабляет строки [row_begin, row_end) через промежуточные вершины [pivot_begin, pivot_end)
+        void RelaxRowBlock(VertexId row_begin, VertexId row_end, VertexId pivot_begin, VertexId pivot_end);
+
+        // Помечает строки новой таблицы, которые нельзя перенести из прежней
+        std::vector<bool> FindAffectedRows(const Graph& previous_graph, const RoutesInternalData& previous_data,
+            const TableLayout& previous_layout, const std::vector<VertexId>& vertex_map,
+            const std::vector<VertexId>& previous_vertices, const std::vector<EdgeId>& edge_map, parallel::ThreadPool& pool) const;
+
+        // Переносит строку источника из прежней таблицы в строку row новой
+        void CopyPreviousRow(size_t row, const Graph& previous_graph, const RoutesInternalData& previous_data,
+            const TableLayout& previous_layout, const std::vector<VertexId>& previous_vertices, const std::vector<EdgeId>& edge_map);
+
+        // Рассчитывает строку row поиском Дейкстры по всему графу
+        void ComputeRowByDijkstra(size_t row);
+
+        // Поиск Дейкстры рассматривает каждое ребро и кладёт каждую вершину в кучу,
+        // а алгоритм Флойда-Уоршелла делает vertex_count^3 шагов без ветвлений.
+        // Веса маршрутов от выбора не зависят, но из маршрутов равного веса алгоритмы могут выбрать разные
+        static bool IsDijkstraCheaper(const Graph& graph, size_t row_count);
+
+        static constexpr size_t BLOCK_SIZE = 64;
+        // Во сколько раз шаг поиска Дейкстры дороже шага алгоритма Флойда-Уоршелла
+        static constexpr size_t DIJKSTRA_STEP_COST = 8;
+        static constexpr size_t COLUMN_TILE_SIZE = 256;
         static constexpr Weight ZERO_WEIGHT{};
         const Graph& graph_;
         RoutesInternalData routes_internal_data_;
+        TableLayout layout_;
+        // Строки промежуточных вершин текущего блока на шаге, где они становятся промежуточными
+        std::vector<Weight> pivot_weights_;
+        std::vector<uint32_t> pivot_prev_edges_;
     };
 
     template <typename Weight>
-    Router<Weight>::Router(const Graph& graph)
+    Router<Weight>::Router(const Graph& graph, size_t thread_count)
+        : Router(graph, ListVertices(graph.GetVertexCount()), thread_count)
+    {
+    }
+
+    template <typename Weight>
+    Router<Weight>::Router(const Graph& graph, std::vector<VertexId> sources, size_t thread_count)
         : graph_(graph)
-        , routes_internal_data_(graph.GetVertexCount(),
-            std::vector<std::optional<RouteInternalData>>(graph.GetVertexCount()))
     {
-        InitializeRoutesInternalData(graph);
+        const size_t vertex_count = graph.GetVertexCount();
+        routes_internal_data_.vertex_count = vertex_count;
+        routes_internal_data_.rows = MakeRows(std::move(sources), vertex_count);
+        layout_ = MakeLayout(graph, routes_internal_data_.rows);
+        if (HasAllRows() && !IsDijkstraCheaper(graph, routes_internal_data_.rows.size())) {
+            InitializeRoutesInternalData(graph);
+            ComputeRoutesInternalData(thread_count);
+            return;
+        }
+        CheckEdges(graph);
+        AllocateRoutesInternalData();
+        if (thread_count == 0) {
+            thread_count = std::thread::hardware_concurrency();
+        }
+        parallel::ThreadPool pool(std::max<size_t>(thread_count, 1));
+        pool.ParallelFor(routes_internal_data_.rows.size(), [&](size_t row) {
+            ComputeRowByDijkstra(row);
+        });
+    }
+
+    template <typename Weight>
+    Router<Weight>::Router(const Graph& graph, std::vector<VertexId> sources, const Graph& previous_graph,
+        const RoutesInternalData& previous_data, const std::vector<VertexId>& vertex_map, const std::vector<EdgeId>& edge_map,
+        size_t thread_count)
+        : graph_(graph)
+    {
+        const size_t vertex_count = graph.GetVertexCount();
+        if (vertex_map.size() != previous_data.vertex_count || previous_graph.GetVertexCount() != previous_data.vertex_count
+            || edge_map.size() != previous_graph.GetEdgeCount()) {
+            throw std::invalid_argument("Previous routes data doesn't match the vertex map");
+        }
+        const TableLayout previous_layout = MakeLayout(previous_graph, previous_data.rows);
+        const size_t previous_cell_count = previous_data.rows.size() * previous_layout.columns.size();
+        if (previous_data.weights.size() != previous_cell_count || previous_data.prev_edges.size() != previous_cell_count) {
+            throw std::invalid_argument("Previous routes data doesn't match the previous graph");
+        }
+        routes_internal_data_.vertex_count = vertex_count;
+        routes_internal_data_.rows = MakeRows(std::move(sources), vertex_count);
+        layout_ = MakeLayout(graph, routes_internal_data_.rows);
+        std::vector<VertexId> previous_vertices(vertex_count, NO_VERTEX);
+        for (VertexId previous_vertex = 0; previous_vertex < vertex_map.size(); ++previous_vertex) {
+            if (vertex_map[previous_vertex] != NO_VERTEX) {
+                previous_vertices.at(vertex_map[previous_vertex]) = previous_vertex;
+            }
+        }
+
+        if (thread_count == 0) {
+            thread_count = std::thread::hardware_concurrency();
+        }
+        parallel::ThreadPool pool(std::max<size_t>(thread_count, 1));
+        const std::vector<bool> affected_rows = FindAffectedRows(previous_graph, previous_data, previous_layout,
+            vertex_map, previous_vertices, edge_map, pool);
+        const size_t affected_count = std::count(affected_rows.begin(), affected_rows.end(), true);
+
+        if (HasAllRows() && !IsDijkstraCheaper(graph, affected_count)) {
+            InitializeRoutesInternalData(graph);
+            ComputeRoutesInternalData(thread_count);
+            return;
+        }
 
+        CheckEdges(graph);
+        AllocateRoutesInternalData();
+        pool.ParallelFor(routes_internal_data_.rows.size(), [&](size_t row) {
+            if (affected_rows[row]) {
+                ComputeRowByDijkstra(row);
+            }
+            else {
+                CopyPreviousRow(row, previous_graph, previous_data, previous_layout, previous_vertices, edge_map);
+            }
+        });
+    }
+
+    template <typename Weight>
+    std::vector<uint32_t> Router<Weight>::MakeRows(std::vector<VertexId> sources, size_t vertex_count) {
+        if (vertex_count >= NO_INDEX) {
+            throw std::length_error("Too many vertices for 32-bit vertex ids");
+        }
+        std::sort(sources.begin(), sources.end());
+        sources.erase(std::unique(sources.begin(), sources.end()), sources.end());
+        if (!sources.empty() && sources.back() >= vertex_count) {
+            throw std::out_of_range("Vertex id is out of range");
+        }
+        return std::vector<uint32_t>(sources.begin(), sources.end());
+    }
+
+    template <typename Weight>
+    std::vector<VertexId> Router<Weight>::ListVertices(size_t vertex_count) {
+        std::vector<VertexId> vertices(vertex_count);
+        std::iota(vertices.begin(), vertices.end(), VertexId{ 0 });
+        return vertices;
+    }
+
+    template <typename Weight>
+    typename Router<Weight>::TableLayout Router<Weight>::MakeLayout(const Graph& graph, const std::vector<uint32_t>& rows) {
         const size_t vertex_count = graph.GetVertexCount();
-        for (VertexId vertex_through = 0; vertex_through < vertex_count; ++vertex_through) {
-            RelaxRoutesInternalDataThroughVertex(vertex_count, vertex_through);
+        if (graph.GetEdgeCount() >= NO_PREV_EDGE) {
+            throw std::length_error("Too many edges for 32-bit edge ids");
+        }
+        TableLayout layout;
+        layout.row_indexes.assign(vertex_count, NO_INDEX);
+        for (size_t row = 0; row < rows.size(); ++row) {
+            if (rows[row] >= vertex_count || (row > 0 && rows[row] <= rows[row - 1])) {
+                throw std::invalid_argument("Sources of routes should be sorted vertices of the graph");
+            }
+            layout.row_indexes[rows[row]] = static_cast<uint32_t>(row);
+        }
+
+        std::vector<uint32_t> in_degrees(vertex_count, 0);
+        layout.chain_edges.assign(vertex_count, NO_PREV_EDGE);
+        for (EdgeId edge_id = 0; edge_id < graph.GetEdgeCount(); ++edge_id) {
+            const VertexId to = graph.GetEdgeUnchecked(edge_id).to;
+            ++in_degrees[to];
+            layout.chain_edges[to] = static_cast<uint32_t>(edge_id);
+        }
+        for (VertexId vertex = 0; vertex < vertex_count; ++vertex) {
+            if (in_degrees[vertex] != 1 || layout.row_indexes[vertex] != NO_INDEX) {
+                layout.chain_edges[vertex] = NO_PREV_EDGE;
+            }
+        }
+        // Цепочка, замкнутая в цикл, получает столбец в вершине, на которой цикл обнаружен
+        std::vector<char> states(vertex_count, 0);// 1 - вершина текущего обхода, 2 - вершина пройденной цепочки
+        std::vector<VertexId> chain;
+        for (VertexId vertex = 0; vertex < vertex_count; ++vertex) {
+            VertexId current = vertex;
+            while (layout.chain_edges[current] != NO_PREV_EDGE && states[current] == 0) {
+                states[current] = 1;
+                chain.push_back(current);
+                current = graph.GetEdgeUnchecked(layout.chain_edges[current]).from;
+            }
+            if (states[current] == 1) {
+                layout.chain_edges[current] = NO_PREV_EDGE;
+            }
+            for (const VertexId chain_vertex : chain) {
+                states[chain_vertex] = 2;
+            }
+            chain.clear();
+        }
+
+        layout.column_indexes.assign(vertex_count, NO_INDEX);
+        for (VertexId vertex = 0; vertex < vertex_count; ++vertex) {
+            if (layout.chain_edges[vertex] == NO_PREV_EDGE) {
+                layout.column_indexes[vertex] = static_cast<uint32_t>(layout.columns.size());
+                layout.columns.push_back(static_cast<uint32_t>(vertex));
+            }
+        }
+        return layout;
+    }
+
+    template <typename Weight>
+    std::pair<Weight, uint32_t> Router<Weight>::FindRouteEnd(const Graph& graph, const RoutesInternalData& data,
+        const TableLayout& layout, size_t row, VertexId to) {
+        thread_local std::vector<uint32_t> chain;
+        chain.clear();
+        VertexId vertex = to;
+        while (layout.chain_edges[vertex] != NO_PREV_EDGE) {
+            chain.push_back(layout.chain_edges[vertex]);
+            vertex = graph.GetEdgeUnchecked(chain.back()).from;
+        }
+        const size_t cell = row * layout.columns.size() + layout.column_indexes[vertex];
+        if (chain.empty()) {
+            return { data.weights[cell], data.prev_edges[cell] };
+        }
+        Weight weight = data.weights[cell];
+        if (weight == UNREACHABLE_WEIGHT) {
+            return { UNREACHABLE_WEIGHT, NO_PREV_EDGE };
+        }
+        for (auto it = chain.rbegin(); it != chain.rend(); ++it) {
+            weight += graph.GetEdgeUnchecked(*it).weight;
+        }
+        return { weight, chain.front() };
+    }
+
+    template <typename Weight>
+    void Router<Weight>::CheckEdges(const Graph& graph) {
+        if (graph.GetEdgeCount() >= NO_PREV_EDGE) {
+            throw std::length_error("Too many edges for 32-bit edge ids");
+        }
+        for (const auto& edge : graph.GetEdges()) {
+            if (edge.weight < ZERO_WEIGHT) {
+                throw std::domain_error("Edges' weights should be non-negative");
+            }
+        }
+    }
+
+    template <typename Weight>
+    void Router<Weight>::AllocateRoutesInternalData() {
+        const size_t cell_count = routes_internal_data_.rows.size() * layout_.columns.size();
+        routes_internal_data_.weights.assign(cell_count, UNREACHABLE_WEIGHT);
+        routes_internal_data_.prev_edges.assign(cell_count, NO_PREV_EDGE);
+    }
+
+    template <typename Weight>
+    std::vector<bool> Router<Weight>::FindAffectedRows(const Graph& previous_graph, const RoutesInternalData& previous_data,
+        const TableLayout& previous_layout, const std::vector<VertexId>& vertex_map,
+        const std::vector<VertexId>& previous_vertices, const std::vector<EdgeId>& edge_map, parallel::ThreadPool& pool) const {
+        const size_t previous_column_count = previous_layout.columns.size();
+        // Рёбра прежнего графа, которых нет в новом графе
+        std::vector<bool> is_removed_edge(edge_map.size());
+        // Рёбра нового графа, которых не было в прежнем графе
+        std::vector<bool> is_added_edge(graph_.GetEdgeCount(), true);
+        for (EdgeId edge_id = 0; edge_id < edge_map.size(); ++edge_id) {
+            if (edge_map[edge_id] == NO_EDGE) {
+                is_removed_edge[edge_id] = true;
+            }
+            else {
+                is_added_edge.at(edge_map[edge_id]) = false;
+            }
+        }
+        // Новые рёбра из прежних вершин; в новые вершины можно попасть только через такие рёбра
+        std::vector<EdgeId> added_edges;
+        for (EdgeId edge_id = 0; edge_id < is_added_edge.size(); ++edge_id) {
+            if (is_added_edge[edge_id] && previous_vertices[graph_.GetEdge(edge_id).from] != NO_VERTEX) {
+                added_edges.push_back(edge_id);
+            }
+        }
+        // Оставшиеся вершины без столбца, единственное входящее ребро которых удалено:
+        // маршруты по такому ребру не видны в прежней таблице
+        std::vector<VertexId> removed_chain_ends;
+        for (VertexId previous_vertex = 0; previous_vertex < previous_layout.chain_edges.size(); ++previous_vertex) {
+            const uint32_t chain_edge = previous_layout.chain_edges[previous_vertex];
+            if (chain_edge != NO_PREV_EDGE && is_removed_edge[chain_edge] && vertex_map[previous_vertex] != NO_VERTEX) {
+                removed_chain_ends.push_back(previous_vertex);
+            }
+        }
+
+        // std::vector<bool> нельзя заполнять из нескольких потоков
+        std::vector<char> is_affected(routes_internal_data_.rows.size(), 1);
+        pool.ParallelFor(routes_internal_data_.rows.size(), [&](size_t row) {
+            const VertexId previous_vertex = previous_vertices[routes_internal_data_.rows[row]];
+            if (previous_vertex == NO_VERTEX || previous_layout.row_indexes[previous_vertex] == NO_INDEX) {
+                return;
+            }
+            const size_t previous_row = previous_layout.row_indexes[previous_vertex];
+            auto previous_weight = [&](VertexId previous_to) {
+                return FindRouteEnd(previous_graph, previous_data, previous_layout, previous_row, previous_to).first;
+            };
+            const uint32_t* prev_edges = &previous_data.prev_edges[previous_row * previous_column_count];
+            // Маршрут до оставшейся вершины проходил по удалённому ребру
+            for (size_t column = 0; column < previous_column_count; ++column) {
+                if (prev_edges[column] != NO_PREV_EDGE && vertex_map[previous_layout.columns[column]] != NO_VERTEX
+                    && is_removed_edge[prev_edges[column]]) {
+                    return;
+                }
+            }
+            for (const VertexId previous_to : removed_chain_ends) {
+                if (previous_weight(previous_to) != UNREACHABLE_WEIGHT) {
+                    return;
+                }
+            }
+            // Новое ребро сокращает маршрут или ведёт в новую вершину
+            for (const EdgeId edge_id : added_edges) {
+                const auto& edge = graph_.GetEdgeUnchecked(edge_id);
+                const Weight weight_from = previous_weight(previous_vertices[edge.from]);
+                if (weight_from == UNREACHABLE_WEIGHT) {
+                    continue;
+                }
+                const VertexId previous_to = previous_vertices[edge.to];
+                if (previous_to == NO_VERTEX || weight_from + edge.weight < previous_weight(previous_to)) {
+                    return;
+                }
+            }
+            is_affected[row] = 0;
+        });
+        return std::vector<bool>(is_affected.begin(), is_affected.end());
+    }
+
+    template <typename Weight>
+    void Router<Weight>::CopyPreviousRow(size_t row, const Graph& previous_graph, const RoutesInternalData& previous_data,
+        const TableLayout& previous_layout, const std::vector<VertexId>& previous_vertices, const std::vector<EdgeId>& edge_map) {
+        const size_t column_count = layout_.columns.size();
+        const size_t previous_row = previous_layout.row_indexes[previous_vertices[routes_internal_data_.rows[row]]];
+        Weight* weights = &routes_internal_data_.weights[row * column_count];
+        uint32_t* prev_edges = &routes_internal_data_.prev_edges[row * column_count];
+        // Новые вершины из строки, которую можно перенести, недостижимы
+        for (size_t column = 0; column < column_count; ++column) {
+            const VertexId previous_to = previous_vertices[layout_.columns[column]];
+            if (previous_to == NO_VERTEX) {
+                continue;
+            }
+            const auto [weight, previous_edge] = FindRouteEnd(previous_graph, previous_data, previous_layout, previous_row, previous_to);
+            weights[column] = weight;
+            prev_edges[column] = previous_edge == NO_PREV_EDGE ? NO_PREV_EDGE : static_cast<uint32_t>(edge_map[previous_edge]);
+        }
+    }
+
+    template <typename Weight>
+    void Router<Weight>::ComputeRowByDijkstra(size_t row) {
+        const size_t column_count = layout_.columns.size();
+        Weight* weights = &routes_internal_data_.weights[row * column_count];
+        uint32_t* prev_edges = &routes_internal_data_.prev_edges[row * column_count];
+        detail::Workspace<Weight>& workspace = detail::GetThreadWorkspace<Weight>();
+        detail::SearchState<Weight> state(workspace.forward, workspace.Start(routes_internal_data_.vertex_count));
+        state.Relax(routes_internal_data_.rows[row], ZERO_WEIGHT, NO_EDGE);
+        while (state.SkipSettled()) {
+            const VertexId settled = state.SettleTop();
+            const Weight weight = state.GetWeight(settled);
+            const uint32_t column = layout_.column_indexes[settled];
+            if (column != NO_INDEX) {
+                const EdgeId prev_edge = state.GetPrevEdge(settled);
+                weights[column] = weight;
+                prev_edges[column] = prev_edge == NO_EDGE ? NO_PREV_EDGE : static_cast<uint32_t>(prev_edge);
+            }
+            graph_.ForEachIncidentEdge(settled, [&](EdgeId edge_id, VertexId edge_to, Weight edge_weight) {
+                state.Relax(edge_to, weight + edge_weight, edge_id);
+            });
+        }
+    }
+
+    template <typename Weight>
+    bool Router<Weight>::IsDijkstraCheaper(const Graph& graph, size_t row_count) {
+        const size_t vertex_count = graph.GetVertexCount();
+        const double dijkstra_cost = static_cast<double>(row_count) * DIJKSTRA_STEP_COST
+            * (graph.GetEdgeCount() + vertex_count * std::log2(vertex_count + 1.0));
+        const double floyd_warshall_cost = static_cast<double>(vertex_count) * vertex_count * vertex_count;
+        return dijkstra_cost < floyd_warshall_cost;
+    }
+
+    template <typename Weight>
+    void Router<Weight>::ComputeRoutesInternalData(size_t thread_count) {
+        const size_t vertex_count = routes_internal_data_.vertex_count;
+        const size_t block_count = (vertex_count + BLOCK_SIZE - 1) / BLOCK_SIZE;
+        pivot_weights_.resize(BLOCK_SIZE * vertex_count);
+        pivot_prev_edges_.resize(BLOCK_SIZE * vertex_count);
+        if (thread_count == 0) {
+            thread_count = std::thread::hardware_concurrency();
+        }
+        parallel::ThreadPool pool(std::max<size_t>(std::min(thread_count, block_count), 1));
+
+        for (size_t pivot_block = 0; pivot_block < block_count; ++pivot_block) {
+            const VertexId pivot_begin = pivot_block * BLOCK_SIZE;
+            const VertexId pivot_end = std::min(vertex_count, pivot_begin + BLOCK_SIZE);
+            PreparePivotRows(pivot_begin, pivot_end);
+            pool.ParallelFor(block_count, [&](size_t row_block) {
+                const VertexId row_begin = row_block * BLOCK_SIZE;
+                RelaxRowBlock(row_begin, std::min(vertex_count, row_begin + BLOCK_SIZE), pivot_begin, pivot_end);
+            });
+        }
+        pivot_weights_ = {};
+        pivot_prev_edges_ = {};
+    }
+
+    template <typename Weight>
+    void Router<Weight>::PreparePivotRows(VertexId pivot_begin, VertexId pivot_end) {
+        const size_t vertex_count = routes_internal_data_.vertex_count;
+        for (VertexId pivot = pivot_begin; pivot < pivot_end; ++pivot) {
+            Weight* weights = &routes_internal_data_.weights[pivot * vertex_count];
+            uint32_t* prev_edges = &routes_internal_data_.prev_edges[pivot * vertex_count];
+            for (VertexId vertex_through = pivot_begin; vertex_through < pivot; ++vertex_through) {
+                const Weight weight_through = weights[vertex_through];
+                if (weight_through != UNREACHABLE_WEIGHT) {
+                    const size_t offset = (vertex_through - pivot_begin) * vertex_count;
+                    RelaxRow(weight_through, prev_edges[vertex_through], &pivot_weights_[offset],
+                        &pivot_prev_edges_[offset], weights, prev_edges, 0, vertex_count);
+                }
+            }
+            const size_t offset = (pivot - pivot_begin) * vertex_count;
+            std::copy(weights, weights + vertex_count, &pivot_weights_[offset]);
+            std::copy(prev_edges, prev_edges + vertex_count, &pivot_prev_edges_[offset]);
+        }
+    }
+
+    template <typename Weight>
+    void Router<Weight>::RelaxRowBlock(VertexId row_begin, VertexId row_end, VertexId pivot_begin, VertexId pivot_end) {
+        const size_t vertex_count = routes_internal_data_.vertex_count;
+        const size_t pivot_count = pivot_end - pivot_begin;
+        // Элементы строк в столбцах промежуточных вершин на шаге, где вершина становится промежуточной
+        Weight column_weights[BLOCK_SIZE][BLOCK_SIZE];
+        uint32_t column_prev_edges[BLOCK_SIZE][BLOCK_SIZE];
+
+        // Строки самих промежуточных вершин уже ослаблены через предшествующие им вершины блока
+        auto first_pivot = [&](VertexId row) {
+            return row >= pivot_begin && row < pivot_end ? row + 1 - pivot_begin : 0;
+        };
+
+        // Сначала столбцы промежуточных вершин: их значения меняются по ходу шагов блока
+        for (VertexId row = row_begin; row < row_end; ++row) {
+            Weight* weights = &routes_internal_data_.weights[row * vertex_count];
+            uint32_t* prev_edges = &routes_internal_data_.prev_edges[row * vertex_count];
+            for (size_t pivot_index = first_pivot(row); pivot_index < pivot_count; ++pivot_index) {
+                const VertexId pivot = pivot_begin + pivot_index;
+                const Weight weight_through = weights[pivot];
+                column_weights[row - row_begin][pivot_index] = weight_through;
+                column_prev_edges[row - row_begin][pivot_index] = prev_edges[pivot];
+                if (weight_through != UNREACHABLE_WEIGHT) {
+                    const size_t offset = pivot_index * vertex_count;
+                    RelaxRow(weight_through, prev_edges[pivot], &pivot_weights_[offset], &pivot_prev_edges_[offset],
+                        weights, prev_edges, pivot_begin, pivot_end);
+                }
+            }
+        }
+
+        for (VertexId column_begin = 0; column_begin < vertex_count; column_begin += COLUMN_TILE_SIZE) {
+            const VertexId column_end = std::min(vertex_count, column_begin + COLUMN_TILE_SIZE);
+            for (VertexId row = row_begin; row < row_end; ++row) {
+                Weight* weights = &routes_internal_data_.weights[row * vertex_count];
+                uint32_t* prev_edges = &routes_internal_data_.prev_edges[row * vertex_count];
+                for (size_t pivot_index = first_pivot(row); pivot_index < pivot_count; ++pivot_index) {
+                    const Weight weight_through = column_weights[row - row_begin][pivot_index];
+                    if (weight_through == UNREACHABLE_WEIGHT) {
+                        continue;
+                    }
+                    const uint32_t prev_edge_through = column_prev_edges[row - row_begin][pivot_index];
+                    const size_t offset = pivot_index * vertex_count;
+                    // Столбцы промежуточных вершин уже обработаны
+                    const VertexId skip_begin = std::max(column_begin, pivot_begin);
+                    const VertexId skip_end = std::min(column_end, pivot_end);
+                    if (skip_begin < skip_end) {
+                        RelaxRow(weight_through, prev_edge_through, &pivot_weights_[offset], &pivot_prev_edges_[offset],
+                            weights, prev_edges, column_begin, skip_begin);
+                        RelaxRow(weight_through, prev_edge_through, &pivot_weights_[offset], &pivot_prev_edges_[offset],
+                            weights, prev_edges, skip_end, column_end);
+                    }
+                    else {
+                        RelaxRow(weight_through, prev_edge_through, &pivot_weights_[offset], &pivot_prev_edges_[offset],
+                            weights, prev_edges, column_begin, column_end);
+                    }
+                }
+            }
         }
     }
 
@@ -102,31 +631,70 @@ namespace graph {
     Router<Weight>::Router(const Graph& graph, RoutesInternalData routes_internal_data)
         : graph_(graph)
         , routes_internal_data_(std::move(routes_internal_data))
-    {}
+    {
+        if (routes_internal_data_.vertex_count != graph.GetVertexCount()) {
+            throw std::invalid_argument("Routes data doesn't match the graph");
+        }
+        layout_ = MakeLayout(graph, routes_internal_data_.rows);
+        const size_t cell_count = routes_internal_data_.rows.size() * layout_.columns.size();
+        if (routes_internal_data_.weights.size() != cell_count || routes_internal_data_.prev_edges.size() != cell_count) {
+            throw std::invalid_argument("Routes data doesn't match the graph");
+        }
+    }
 
     template <typename Weight>
     std::optional<typename Router<Weight>::RouteInfo> Router<Weight>::BuildRoute(VertexId from,
         VertexId to) const {
-        const auto& route_internal_data = routes_internal_data_.at(from).at(to);
-        if (!route_internal_data) {
+        const size_t vertex_count = routes_internal_data_.vertex_count;
+        if (from >= vertex_count || to >= vertex_count) {
+            throw std::out_of_range("Vertex id is out of range");
+        }
+        const uint32_t row = layout_.row_indexes[from];
+        if (row == NO_INDEX) {
+            throw std::invalid_argument("Routes from the vertex aren't stored");
+        }
+        const auto [weight, last_edge] = FindRouteEnd(graph_, routes_internal_data_, layout_, row, to);
+        if (weight == UNREACHABLE_WEIGHT) {
             return std::nullopt;
         }
-        const Weight weight = route_internal_data->weight;
+        const uint32_t* prev_edges = &routes_internal_data_.prev_edges[row * layout_.columns.size()];
         std::vector<EdgeId> edges;
-        for (std::optional<EdgeId> edge_id = route_internal_data->prev_edge;
-            edge_id;
-            edge_id = routes_internal_data_[from][graph_.GetEdge(*edge_id).from]->prev_edge)
-        {
-            edges.push_back(*edge_id);
+        for (uint32_t edge_id = last_edge; edge_id != NO_PREV_EDGE;) {
+            edges.push_back(edge_id);
+            const VertexId vertex = graph_.GetEdgeUnchecked(edge_id).from;
+            edge_id = layout_.chain_edges[vertex] != NO_PREV_EDGE
+                ? layout_.chain_edges[vertex] : prev_edges[layout_.column_indexes[vertex]];
         }
         std::reverse(edges.begin(), edges.end());
 
         return RouteInfo{ weight, std::move(edges) };
     }
 
+    template <typename Weight>
+    std::optional<Weight> Router<Weight>::ComputeRouteWeight(VertexId from, VertexId to) const {
+        const size_t vertex_count = routes_internal_data_.vertex_count;
+        if (from >= vertex_count || to >= vertex_count) {
+            throw std::out_of_range("Vertex id is out of range");
+        }
+        const uint32_t row = layout_.row_indexes[from];
+        if (row == NO_INDEX) {
+            throw std::invalid_argument("Routes from the vertex aren't stored");
+        }
+        const Weight weight = FindRouteEnd(graph_, routes_internal_data_, layout_, row, to).first;
+        if (weight == UNREACHABLE_WEIGHT) {
+            return std::nullopt;
+        }
+        return weight;
+    }
+
     template <typename Weight>
     const typename Router<Weight>::RoutesInternalData& Router<Weight>::GetData() const {
         return routes_internal_data_;
     }
 
+    template <typename Weight>
+    typename Router<Weight>::RoutesInternalData Router<Weight>::ReleaseData() {
+        return std::move(routes_internal_data_);
+    }
+
 }  // namespace graph
\ No newline at end of file
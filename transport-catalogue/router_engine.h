@@ -0,0 +1,41 @@
+#pragma once
+#include "graph.h"
+
+#include <optional>
+#include <vector>
+
+namespace graph {
+
+    // Общий интерфейс движков поиска кратчайшего пути по графу
+    template <typename Weight>
+    class RouterEngine {
+    public:
+        struct RouteInfo {
+            Weight weight;
+            std::vector<EdgeId> edges;
+        };
+
+        virtual std::optional<RouteInfo> BuildRoute(VertexId from, VertexId to) const = 0;
+
+        // Вес кратчайшего маршрута без восстановления его рёбер
+        virtual std::optional<Weight> ComputeRouteWeight(VertexId from, VertexId to) const {
+            if (auto route_info = BuildRoute(from, to)) {
+                return route_info->weight;
+            }
+            return std::nullopt;
+        }
+
+        // Веса кратчайших маршрутов из вершины from в каждую из вершин targets
+        virtual std::vector<std::optional<Weight>> ComputeRouteWeights(VertexId from, const std::vector<VertexId>& targets) const {
+            std::vector<std::optional<Weight>> weights;
+            weights.reserve(targets.size());
+            for (const VertexId to : targets) {
+                weights.push_back(ComputeRouteWeight(from, to));
+            }
+            return weights;
+        }
+
+        virtual ~RouterEngine() = default;
+    };
+
+}  // namespace graph
@@ -0,0 +1,244 @@
+#pragma once
+#include "graph.h"
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace graph {
+
+    namespace detail {
+
+        inline constexpr EdgeId NO_EDGE = std::numeric_limits<EdgeId>::max();
+
+        // Двоичная куча пар (вес, вершина) с минимумом на вершине
+        template <typename Weight>
+        class BinaryHeap {
+        public:
+            void Clear() {
+                items_.clear();
+            }
+
+            bool IsEmpty() const {
+                return items_.empty();
+            }
+
+            void Push(Weight weight, VertexId vertex) {
+                items_.emplace_back(weight, vertex);
+                std::push_heap(items_.begin(), items_.end(), std::greater<>{});
+            }
+
+            const std::pair<Weight, VertexId>& Top() const {
+                return items_.front();
+            }
+
+            void Pop() {
+                std::pop_heap(items_.begin(), items_.end(), std::greater<>{});
+                items_.pop_back();
+            }
+
+        private:
+            std::vector<std::pair<Weight, VertexId>> items_;
+        };
+
+        inline size_t GetBitWidth(uint64_t value) {
+#if defined(__GNUC__)
+            return value == 0 ? 0 : 64 - __builtin_clzll(value);
+#else
+            size_t width = 0;
+            for (; value != 0; value >>= 1) {
+                ++width;
+            }
+            return width;
+#endif
+        }
+
+        // Поразрядная (radix) куча для целочисленных весов. Годится для поиска Дейкстры,
+        // где вес добавляемой вершины не меньше последнего извлечённого минимума last_:
+        // ключ попадает в корзину по старшему биту, которым он отличается от last_.
+        // Корзина 0 хранит вершины веса last_; когда она пустеет, следующий минимум
+        // ищется только при обращении к вершине кучи, чтобы last_ не обогнал ещё не добавленные веса
+        template <typename Weight>
+        class RadixHeap {
+        public:
+            void Clear() {
+                for (auto& bucket : buckets_) {
+                    bucket.clear();
+                }
+                size_ = 0;
+                last_ = Weight{};
+            }
+
+            bool IsEmpty() const {
+                return size_ == 0;
+            }
+
+            void Push(Weight weight, VertexId vertex) {
+                assert(!(weight < last_));
+                buckets_[GetBucket(weight)].emplace_back(weight, vertex);
+                ++size_;
+            }
+
+            const std::pair<Weight, VertexId>& Top() const {
+                if (buckets_[0].empty()) {
+                    Refill();
+                }
+                return buckets_[0].back();
+            }
+
+            void Pop() {
+                Top();
+                buckets_[0].pop_back();
+                --size_;
+            }
+
+        private:
+            static constexpr size_t BUCKET_COUNT = std::numeric_limits<Weight>::digits + 1;
+
+            size_t GetBucket(Weight weight) const {
+                return GetBitWidth(static_cast<uint64_t>(weight ^ last_));
+            }
+
+            // Новый минимум берётся из первой непустой корзины, её элементы расходятся по младшим корзинам
+            void Refill() const {
+                size_t index = 1;
+                while (buckets_[index].empty()) {
+                    ++index;
+                }
+                auto& bucket = buckets_[index];
+                last_ = std::min_element(bucket.begin(), bucket.end())->first;
+                for (const auto& item : bucket) {
+                    buckets_[GetBucket(item.first)].push_back(item);
+                }
+                bucket.clear();
+            }
+
+            mutable std::array<std::vector<std::pair<Weight, VertexId>>, BUCKET_COUNT> buckets_;
+            size_t size_ = 0;
+            mutable Weight last_{};
+        };
+
+        // Очередь поиска: поразрядная куча для целочисленных весов, двоичная для остальных
+        template <typename Weight>
+        using SearchQueue = std::conditional_t<std::is_integral_v<Weight>, RadixHeap<Weight>, BinaryHeap<Weight>>;
+
+        // Состояние поиска Дейкстры в одном направлении. Метки поколений позволяют
+        // не очищать массивы перед каждым запросом.
+        template <typename Weight>
+        struct SearchSpace {
+            std::vector<Weight> weights;
+            std::vector<EdgeId> prev_edges;
+            std::vector<uint32_t> reached;
+            std::vector<uint32_t> settled;
+            SearchQueue<Weight> heap;
+
+            void Reset(size_t vertex_count) {
+                if (weights.size() < vertex_count) {
+                    weights.resize(vertex_count);
+                    prev_edges.resize(vertex_count);
+                    reached.resize(vertex_count, 0);
+                    settled.resize(vertex_count, 0);
+                }
+                heap.Clear();
+            }
+
+            void Clear() {
+                std::fill(reached.begin(), reached.end(), 0);
+                std::fill(settled.begin(), settled.end(), 0);
+            }
+        };
+
+        template <typename Weight>
+        class SearchState {
+        public:
+            SearchState(SearchSpace<Weight>& space, uint32_t generation)
+                : space_(space)
+                , generation_(generation) {
+            }
+
+            bool IsReached(VertexId vertex) const {
+                return space_.reached[vertex] == generation_;
+            }
+
+            bool IsSettled(VertexId vertex) const {
+                return space_.settled[vertex] == generation_;
+            }
+
+            Weight GetWeight(VertexId vertex) const {
+                return space_.weights[vertex];
+            }
+
+            EdgeId GetPrevEdge(VertexId vertex) const {
+                return space_.prev_edges[vertex];
+            }
+
+            bool Relax(VertexId vertex, Weight weight, EdgeId prev_edge) {
+                if (IsReached(vertex) && !(weight < space_.weights[vertex])) {
+                    return false;
+                }
+                space_.reached[vertex] = generation_;
+                space_.weights[vertex] = weight;
+                space_.prev_edges[vertex] = prev_edge;
+                space_.heap.Push(weight, vertex);
+                return true;
+            }
+
+            // Выбрасывает из кучи вершины, которые уже рассмотрены
+            bool SkipSettled() {
+                while (!space_.heap.IsEmpty() && IsSettled(space_.heap.Top().second)) {
+                    space_.heap.Pop();
+                }
+                return !space_.heap.IsEmpty();
+            }
+
+            Weight TopWeight() const {
+                return space_.heap.Top().first;
+            }
+
+            VertexId SettleTop() {
+                const VertexId vertex = space_.heap.Top().second;
+                space_.heap.Pop();
+                space_.settled[vertex] = generation_;
+                return vertex;
+            }
+
+        private:
+            SearchSpace<Weight>& space_;
+            uint32_t generation_;
+        };
+
+        // Рабочая область двунаправленного поиска; переиспользуется всеми запросами одного потока
+        template <typename Weight>
+        struct Workspace {
+            SearchSpace<Weight> forward;
+            SearchSpace<Weight> backward;
+            uint32_t generation = 0;
+
+            // Готовит рабочую область к новому запросу и возвращает его поколение
+            uint32_t Start(size_t vertex_count) {
+                forward.Reset(vertex_count);
+                backward.Reset(vertex_count);
+                if (++generation == 0) {
+                    forward.Clear();
+                    backward.Clear();
+                    generation = 1;
+                }
+                return generation;
+            }
+        };
+
+        template <typename Weight>
+        Workspace<Weight>& GetThreadWorkspace() {
+            static thread_local Workspace<Weight> workspace;
+            return workspace;
+        }
+
+    }  // namespace detail
+
+}  // namespace graph
@@ -1,10 +1,12 @@
 #include "serialization.h"
 
 #include <algorithm>
+#include <cstring>
 #include <variant>
 #include <string>
 #include <fstream>
 #include <memory>
+#include <stdexcept>
 
 namespace transport_directory {
 	namespace serialization_tr_catalogue {
@@ -12,7 +14,7 @@ namespace transport_directory {
 		namespace detail {
 			transport_catalogue_serialize::Stop CreateProtoStop(const domain::Stop& stop) {
 				transport_catalogue_serialize::Stop proto_stop;
-				proto_stop.set_name(stop.name);
+				proto_stop.set_name(std::string(stop.name));
 				transport_catalogue_serialize::Coordinates proto_coors;
 				proto_coors.set_lat(stop.coordinates.lat);
 				proto_coors.set_lng(stop.coordinates.lng);
@@ -20,49 +22,59 @@ namespace transport_directory {
 				return proto_stop;
 			}
 
-			transport_catalogue_serialize::BusRoute CreateProtoBusRoute(const domain::BusRoute& bus_route,
-				const std::unordered_map<std::string_view, size_t>& stops_indexes) {
-
+			transport_catalogue_serialize::BusRoute CreateProtoBusRoute(const domain::BusRoute& bus_route, const transport_catalogue::BusStat* stat) {
 				transport_catalogue_serialize::BusRoute proto_bus_route;
-				proto_bus_route.set_name(bus_route.name);
+				proto_bus_route.set_name(std::string(bus_route.name));
 				proto_bus_route.set_roundtrip(bus_route.is_roundtrip);
 				for (const domain::Stop* stop : bus_route.route) {
-					proto_bus_route.add_index_stops(stops_indexes.at(stop->name));
+					proto_bus_route.add_index_stops(stop->id);
+				}
+				if (stat) {
+					transport_catalogue_serialize::BusStat& proto_stat = *proto_bus_route.mutable_stat();
+					proto_stat.set_stop_count(stat->stop_count);
+					proto_stat.set_unique_stop_count(stat->unique_stop_count);
+					proto_stat.set_route_length(stat->route_length);
+					proto_stat.set_curvature(stat->curvature);
 				}
 				return proto_bus_route;
 			}
 
-			transport_catalogue_serialize::Distance CreateProtoDistance(const std::pair<const domain::Stop*, const domain::Stop*>& stops,
-				int distance, const std::unordered_map<std::string_view, size_t>& stops_indexes) {
-
+			transport_catalogue_serialize::Distance CreateProtoDistance(const transport_catalogue::RoadDistance& distance) {
 				transport_catalogue_serialize::Distance proto_distance;
-				proto_distance.set_index_stop_from(stops_indexes.at(stops.first->name));
-				proto_distance.set_index_stop_to(stops_indexes.at(stops.second->name));
-				proto_distance.set_distance(distance);
+				proto_distance.set_index_stop_from(distance.from);
+				proto_distance.set_index_stop_to(distance.to);
+				proto_distance.set_distance(distance.distance);
 				return proto_distance;
 			}
 
 			transport_catalogue_serialize::TransportCatalogue CreateProtoTransportCatalogue(const transport_catalogue::TransportCatalogue& guide) {
-				const std::deque<domain::BusRoute>& bus_routes = guide.GetBusRoutes();
-				const std::deque<domain::Stop>& stops = guide.GetStops();
-				const std::unordered_map<std::pair<const domain::Stop*, const domain::Stop*>, int, transport_catalogue::TransportCatalogue::DistancesHasher>& 
-					distances = guide.GetDistances();
+				const std::vector<domain::BusRoute>& bus_routes = guide.GetBusRoutes();
+				const std::vector<domain::Stop>& stops = guide.GetStops();
+				const std::vector<transport_catalogue::RoadDistance>& distances = guide.GetDistances();
 
 				transport_catalogue_serialize::TransportCatalogue proto_guide;
-				const auto& stops_indexes = guide.GetIndexedOfStops();
-				int index = 0;
 				for (const auto& stop : stops) {
 					transport_catalogue_serialize::Stop proto_stop(CreateProtoStop(stop));
 					*proto_guide.add_stops() = std::move(proto_stop);
 				}
+				const std::vector<transport_catalogue::BusStat>& bus_stats = guide.GetBusStats();
 				for (const auto& bus_route : bus_routes) {
-					transport_catalogue_serialize::BusRoute proto_bus_route(CreateProtoBusRoute(bus_route, stops_indexes));
+					const transport_catalogue::BusStat* stat = bus_route.id < bus_stats.size() ? &bus_stats[bus_route.id] : nullptr;
+					transport_catalogue_serialize::BusRoute proto_bus_route(CreateProtoBusRoute(bus_route, stat));
 					*proto_guide.add_bus_routes() = std::move(proto_bus_route);
 				}
-				for (const auto& [stop, distance] : distances) {
-					transport_catalogue_serialize::Distance proto_distance(CreateProtoDistance(stop, distance, stops_indexes));
+				for (const auto& distance : distances) {
+					transport_catalogue_serialize::Distance proto_distance(CreateProtoDistance(distance));
 					*proto_guide.add_distances() = std::move(proto_distance);
 				}
+				proto_guide.mutable_stop_bus_offsets()->Reserve(static_cast<int>(stops.size() + 1));
+				proto_guide.add_stop_bus_offsets(0);
+				for (const auto& stop : stops) {
+					for (const domain::BusRoute* bus : guide.GetStopBuses(stop.id)) {
+						proto_guide.add_stop_buses(bus->id);
+					}
+					proto_guide.add_stop_bus_offsets(static_cast<uint32_t>(proto_guide.stop_buses_size()));
+				}
 				return proto_guide;
 			}
 
@@ -120,8 +132,14 @@ namespace transport_directory {
 				std::vector<domain::Stop> stops(GetStops(proto_guide));
 				std::vector<DistanceBetweenStops> distances(GetDistances(proto_guide));
 
-				std::for_each(stops.begin(), stops.end(), [&guide](domain::Stop& stop) {
-					guide.AddStop(std::move(stop.name), stop.coordinates);
+				size_t route_stop_count = 0;
+				for (const BusRoute& bus_route : bus_routes) {
+					route_stop_count += bus_route.stops.size();
+				}
+				guide.Reserve(stops.size(), bus_routes.size(), route_stop_count);
+
+				std::for_each(stops.begin(), stops.end(), [&guide](const domain::Stop& stop) {
+					guide.AddStop(stop.name, stop.coordinates);
 					});
 				
 				std::for_each(distances.begin(), distances.end(), [&guide](const DistanceBetweenStops& distance) {
@@ -129,11 +147,39 @@ namespace transport_directory {
 					const domain::Stop* to = guide.SearchStop(distance.to);
 					guide.SetDistance(from, to, distance.distance);
 					});
+				guide.BuildDistances();
 
-				std::for_each(bus_routes.begin(), bus_routes.end(), [&guide](BusRoute& bus_route) {
-					guide.AddBusRoute(std::move(bus_route.name), std::move(bus_route.stops), bus_route.is_roundtrip);
+				std::for_each(bus_routes.begin(), bus_routes.end(), [&guide](const BusRoute& bus_route) {
+					guide.AddBusRoute(bus_route.name, bus_route.stops, bus_route.is_roundtrip);
 					});
 
+				if (proto_guide.stop_bus_offsets_size() > 0) {
+					guide.SetStopBuses({ proto_guide.stop_bus_offsets().begin(), proto_guide.stop_bus_offsets().end() },
+						{ proto_guide.stop_buses().begin(), proto_guide.stop_buses().end() });
+				}
+				else {
+					guide.BuildStopBuses();
+				}
+
+				std::vector<transport_catalogue::BusStat> bus_stats;
+				bus_stats.reserve(proto_guide.bus_routes_size());
+				for (const auto& proto_bus_route : proto_guide.bus_routes()) {
+					if (!proto_bus_route.has_stat()) {
+						break;
+					}
+					transport_catalogue::BusStat& stat = bus_stats.emplace_back();
+					stat.stop_count = proto_bus_route.stat().stop_count();
+					stat.unique_stop_count = proto_bus_route.stat().unique_stop_count();
+					stat.route_length = proto_bus_route.stat().route_length();
+					stat.curvature = proto_bus_route.stat().curvature();
+				}
+				if (bus_stats.size() == static_cast<size_t>(proto_guide.bus_routes_size())) {
+					guide.SetBusStats(std::move(bus_stats));
+				}
+				else {
+					guide.ComputeBusStats();
+				}
+
 				return guide;
 			}
 
@@ -258,12 +304,74 @@ namespace transport_directory {
 				return render_settings;
 			}
 
+			transport_catalogue_serialize::RouterType CreateProtoRouterType(transport_router::TransportRouter::RouterType router_type) {
+				switch (router_type) {
+				case transport_router::TransportRouter::RouterType::ON_DEMAND:
+					return transport_catalogue_serialize::ON_DEMAND;
+				case transport_router::TransportRouter::RouterType::CONTRACTION_HIERARCHY:
+					return transport_catalogue_serialize::CONTRACTION_HIERARCHY;
+				case transport_router::TransportRouter::RouterType::RAPTOR:
+					return transport_catalogue_serialize::RAPTOR;
+				case transport_router::TransportRouter::RouterType::HUB_LABELS:
+					return transport_catalogue_serialize::HUB_LABELS;
+				case transport_router::TransportRouter::RouterType::CUSTOMIZABLE_CONTRACTION_HIERARCHY:
+					return transport_catalogue_serialize::CUSTOMIZABLE_CONTRACTION_HIERARCHY;
+				default:
+					return transport_catalogue_serialize::ALL_PAIRS;
+				}
+			}
+
+			transport_router::TransportRouter::RouterType GetRouterType(transport_catalogue_serialize::RouterType proto_router_type) {
+				switch (proto_router_type) {
+				case transport_catalogue_serialize::ON_DEMAND:
+					return transport_router::TransportRouter::RouterType::ON_DEMAND;
+				case transport_catalogue_serialize::CONTRACTION_HIERARCHY:
+					return transport_router::TransportRouter::RouterType::CONTRACTION_HIERARCHY;
+				case transport_catalogue_serialize::RAPTOR:
+					return transport_router::TransportRouter::RouterType::RAPTOR;
+				case transport_catalogue_serialize::HUB_LABELS:
+					return transport_router::TransportRouter::RouterType::HUB_LABELS;
+				case transport_catalogue_serialize::CUSTOMIZABLE_CONTRACTION_HIERARCHY:
+					return transport_router::TransportRouter::RouterType::CUSTOMIZABLE_CONTRACTION_HIERARCHY;
+				default:
+					return transport_router::TransportRouter::RouterType::ALL_PAIRS;
+				}
+			}
+
+			transport_catalogue_serialize::GraphModel CreateProtoGraphModel(transport_router::TransportRouter::GraphModel graph_model) {
+				switch (graph_model) {
+				case transport_router::TransportRouter::GraphModel::RIDE_VERTICES:
+					return transport_catalogue_serialize::RIDE_VERTICES;
+				case transport_router::TransportRouter::GraphModel::STOP_VERTICES:
+					return transport_catalogue_serialize::STOP_VERTICES;
+				default:
+					return transport_catalogue_serialize::STOP_PAIRS;
+				}
+			}
+
+			transport_router::TransportRouter::GraphModel GetGraphModel(transport_catalogue_serialize::GraphModel proto_graph_model) {
+				switch (proto_graph_model) {
+				case transport_catalogue_serialize::RIDE_VERTICES:
+					return transport_router::TransportRouter::GraphModel::RIDE_VERTICES;
+				case transport_catalogue_serialize::STOP_VERTICES:
+					return transport_router::TransportRouter::GraphModel::STOP_VERTICES;
+				default:
+					return transport_router::TransportRouter::GraphModel::STOP_PAIRS;
+				}
+			}
+
 			transport_catalogue_serialize::RoutingSettings CreateProtoRoutingSettings(
 				const transport_router::TransportRouter::RoutingSettings& routing_settings) {
 
 				transport_catalogue_serialize::RoutingSettings proto_routing_settings;
 				proto_routing_settings.set_bus_wait_time(routing_settings.bus_wait_time);
 				proto_routing_settings.set_bus_velocity(routing_settings.bus_velocity);
+				proto_routing_settings.set_router_type(CreateProtoRouterType(routing_settings.router_type));
+				proto_routing_settings.set_bidirectional_search(routing_settings.bidirectional_search);
+				proto_routing_settings.set_graph_model(CreateProtoGraphModel(routing_settings.graph_model));
+				for (const std::string& name : routing_settings.closed_stops) {
+					proto_routing_settings.add_closed_stops(name);
+				}
 				return proto_routing_settings;
 			}
 
@@ -273,6 +381,10 @@ namespace transport_directory {
 				transport_router::TransportRouter::RoutingSettings routing_settings;
 				routing_settings.bus_wait_time = proto_routing_settings.bus_wait_time();
 				routing_settings.bus_velocity = proto_routing_settings.bus_velocity();
+				routing_settings.router_type = GetRouterType(proto_routing_settings.router_type());
+				routing_settings.bidirectional_search = proto_routing_settings.bidirectional_search();
+				routing_settings.graph_model = GetGraphModel(proto_routing_settings.graph_model());
+				routing_settings.closed_stops.assign(proto_routing_settings.closed_stops().begin(), proto_routing_settings.closed_stops().end());
 				return routing_settings;
 			}
 
@@ -306,93 +418,112 @@ namespace transport_directory {
 				for (int i = 0; i < proto_graph.edges_size(); ++i) {
 					graph.AddEdge(GetEdge(proto_graph.edges(i)));
 				}
+				graph.Freeze();
 				return graph;
 			}
 
-			transport_catalogue_serialize::RouteInternalData CreateProtoRouteInternalData(
-				const graph::Router<transport_router::Weight>::RouteInternalData& route_internal_data) {
-
-				transport_catalogue_serialize::RouteInternalData proto_route_internal_data;
-				proto_route_internal_data.set_weight(route_internal_data.weight);
-				if (route_internal_data.prev_edge.has_value()) {
-					transport_catalogue_serialize::EdgeId proto_prev_edge;
-					proto_prev_edge.set_id(*route_internal_data.prev_edge);
-					*proto_route_internal_data.mutable_prev_edge() = std::move(proto_prev_edge);
+			transport_catalogue_serialize::RoutesInternalData CreateProtoRoutesInternalData(
+				graph::Router<transport_router::Weight>::RoutesInternalData&& routes_internal_data) {
+
+				transport_catalogue_serialize::RoutesInternalData proto_routes_internal_data;
+				proto_routes_internal_data.set_vertex_count(static_cast<uint32_t>(routes_internal_data.vertex_count));
+				proto_routes_internal_data.mutable_rows()->Add(routes_internal_data.rows.begin(), routes_internal_data.rows.end());
+				proto_routes_internal_data.set_weights(reinterpret_cast<const char*>(routes_internal_data.weights.data()),
+					routes_internal_data.weights.size() * sizeof(transport_router::Weight));
+				routes_internal_data.weights = {};
+				proto_routes_internal_data.set_prev_edges(reinterpret_cast<const char*>(routes_internal_data.prev_edges.data()),
+					routes_internal_data.prev_edges.size() * sizeof(uint32_t));
+				routes_internal_data.prev_edges = {};
+				return proto_routes_internal_data;
+			}
+
+			graph::Router<transport_router::Weight>::RoutesInternalData GetRoutesInternalData(
+				transport_catalogue_serialize::RoutesInternalData&& proto_routes_internal_data) {
+
+				graph::Router<transport_router::Weight>::RoutesInternalData routes_internal_data;
+				std::unique_ptr<std::string> weights_holder(proto_routes_internal_data.release_weights());
+				std::unique_ptr<std::string> prev_edges_holder(proto_routes_internal_data.release_prev_edges());
+				const std::string& weights = *weights_holder;
+				const std::string& prev_edges = *prev_edges_holder;
+				// число столбцов зависит от графа, поэтому размер таблицы проверяет graph::Router
+				const size_t cell_count = prev_edges.size() / sizeof(uint32_t);
+				if (prev_edges.size() % sizeof(uint32_t) != 0 || weights.size() != cell_count * sizeof(transport_router::Weight)) {
+					throw std::invalid_argument("Routes data is corrupted");
 				}
-				proto_route_internal_data.set_is_init(true);
-				return proto_route_internal_data;
-			}
-
-			graph::Router<transport_router::Weight>::RouteInternalData GetRouteInternalData(
-				const transport_catalogue_serialize::RouteInternalData& proto_route_internal_data) {
-
-				graph::Router<transport_router::Weight>::RouteInternalData route_internal_data;
-				route_internal_data.weight = proto_route_internal_data.weight();
-				if (proto_route_internal_data.has_prev_edge()) {
-					route_internal_data.prev_edge = proto_route_internal_data.prev_edge().id();
+				routes_internal_data.vertex_count = proto_routes_internal_data.vertex_count();
+				routes_internal_data.rows.assign(proto_routes_internal_data.rows().begin(), proto_routes_internal_data.rows().end());
+				routes_internal_data.weights.resize(cell_count);
+				routes_internal_data.prev_edges.resize(cell_count);
+				std::memcpy(routes_internal_data.weights.data(), weights.data(), weights.size());
+				weights_holder.reset();
+				std::memcpy(routes_internal_data.prev_edges.data(), prev_edges.data(), prev_edges.size());
+				return routes_internal_data;
+			}
+
+			transport_catalogue_serialize::ContractionHierarchy CreateProtoContractionHierarchy(
+				const graph::ContractionHierarchy<transport_router::Weight>::HierarchyData& hierarchy) {
+
+				transport_catalogue_serialize::ContractionHierarchy proto_hierarchy;
+				for (const size_t rank : hierarchy.ranks) {
+					proto_hierarchy.add_ranks(rank);
 				}
-				return route_internal_data;
-			}
-
-			transport_catalogue_serialize::ArrayRouteInternalData CreateProtoArrayRouteInternalData(
-				std::vector<std::optional<graph::Router<transport_router::Weight>::RouteInternalData>> array_route_internal_data) {
-
-				transport_catalogue_serialize::ArrayRouteInternalData proto_array_route_internal_data;
-				for (const auto& opt_route_internal_data : array_route_internal_data) {
-					auto ptr_elem = proto_array_route_internal_data.add_array_route_internal_data();
-					if (opt_route_internal_data) {
-						*ptr_elem = CreateProtoRouteInternalData(*opt_route_internal_data);
+				for (const auto& edge : hierarchy.edges) {
+					transport_catalogue_serialize::HierarchyEdge& proto_edge = *proto_hierarchy.add_edges();
+					proto_edge.set_from(edge.from);
+					proto_edge.set_to(edge.to);
+					proto_edge.set_weight(edge.weight);
+					proto_edge.set_first(edge.first);
+					if (edge.second) {
+						proto_edge.mutable_second()->set_id(*edge.second);
 					}
 				}
-				return proto_array_route_internal_data;
-			}
-
-			std::vector<std::optional<graph::Router<transport_router::Weight>::RouteInternalData>> GetArrayRouteInternalData(
-				const transport_catalogue_serialize::ArrayRouteInternalData& proto_array_route_internal_data) {
-
-				std::vector<std::optional<graph::Router<transport_router::Weight>::RouteInternalData>>
-					array_route_internal_data(proto_array_route_internal_data.array_route_internal_data_size());
-
-				for (int i = 0; i < proto_array_route_internal_data.array_route_internal_data_size(); ++i) {
-					if (proto_array_route_internal_data.array_route_internal_data(i).is_init()) {
-						array_route_internal_data[i] = GetRouteInternalData(proto_array_route_internal_data.array_route_internal_data(i));
+				return proto_hierarchy;
+			}
+
+			graph::ContractionHierarchy<transport_router::Weight>::HierarchyData GetContractionHierarchy(
+				const transport_catalogue_serialize::ContractionHierarchy& proto_hierarchy) {
+
+				graph::ContractionHierarchy<transport_router::Weight>::HierarchyData hierarchy;
+				hierarchy.ranks.assign(proto_hierarchy.ranks().begin(), proto_hierarchy.ranks().end());
+				hierarchy.edges.reserve(proto_hierarchy.edges_size());
+				for (const auto& proto_edge : proto_hierarchy.edges()) {
+					auto& edge = hierarchy.edges.emplace_back();
+					edge.from = proto_edge.from();
+					edge.to = proto_edge.to();
+					edge.weight = proto_edge.weight();
+					edge.first = proto_edge.first();
+					if (proto_edge.has_second()) {
+						edge.second = proto_edge.second().id();
 					}
 				}
-				return array_route_internal_data;
+				return hierarchy;
 			}
 
-			transport_catalogue_serialize::StopId CreateProtoPairStopId(
-				const std::pair<const domain::Stop*, transport_router::EdgeId>& stop_id, 
-				const transport_catalogue::TransportCatalogue& guide) {
-
-				const auto& stop_indexes = guide.GetIndexedOfStops();
-				transport_catalogue_serialize::StopId proto_stop_id;
-				proto_stop_id.set_stop(stop_indexes.at(stop_id.first->name));
-				proto_stop_id.set_id(stop_id.second);
-				return proto_stop_id;
+			transport_catalogue_serialize::HubLabels CreateProtoHubLabels(const graph::HubLabels<transport_router::Weight>::Labels& labels) {
+				transport_catalogue_serialize::HubLabels proto_labels;
+				proto_labels.mutable_offsets()->Add(labels.offsets.begin(), labels.offsets.end());
+				proto_labels.mutable_hubs()->Add(labels.hubs.begin(), labels.hubs.end());
+				proto_labels.mutable_weights()->Add(labels.weights.begin(), labels.weights.end());
+				proto_labels.mutable_parent_edges()->Add(labels.parent_edges.begin(), labels.parent_edges.end());
+				return proto_labels;
 			}
 
-			std::pair<const domain::Stop*, transport_router::EdgeId> GetPairStopId(transport_catalogue_serialize::StopId proto_stop_id,
-				const transport_catalogue::TransportCatalogue& guide) {
-				const auto& stops = guide.GetStops();
-				std::pair<const domain::Stop*, transport_router::EdgeId> stop_id{&stops[proto_stop_id.stop()], proto_stop_id.id() };
-				return stop_id;
+			graph::HubLabels<transport_router::Weight>::Labels GetHubLabels(const transport_catalogue_serialize::HubLabels& proto_labels) {
+				graph::HubLabels<transport_router::Weight>::Labels labels;
+				labels.offsets.assign(proto_labels.offsets().begin(), proto_labels.offsets().end());
+				labels.hubs.assign(proto_labels.hubs().begin(), proto_labels.hubs().end());
+				labels.weights.assign(proto_labels.weights().begin(), proto_labels.weights().end());
+				labels.parent_edges.assign(proto_labels.parent_edges().begin(), proto_labels.parent_edges().end());
+				return labels;
 			}
 
-			transport_catalogue_serialize::DataEdge CreateProtoDataEdge(const transport_router::TransportRouter::DataEdge& data_edge, 
-				const transport_catalogue::TransportCatalogue& guide) {
+			transport_catalogue_serialize::DataEdge CreateProtoDataEdge(const transport_router::TransportRouter::DataEdge& data_edge) {
 				transport_catalogue_serialize::DataEdge proto_data_edge;
 				if (std::holds_alternative<const domain::Stop*>(data_edge.obj)) {
-					const auto& stop_indexes = guide.GetIndexedOfStops();
-					transport_catalogue_serialize::StopName stop_name;
-					stop_name.set_name(stop_indexes.at(std::get<const domain::Stop*>(data_edge.obj)->name));
-					*proto_data_edge.mutable_stop() = std::move(stop_name);
+					proto_data_edge.mutable_stop()->set_name(std::get<const domain::Stop*>(data_edge.obj)->id);
 				}
 				else {
-					const auto& bus_route_indexes = guide.GetIndexesOfBusRoutes();
-					transport_catalogue_serialize::BusName bus_name;
-					bus_name.set_name(bus_route_indexes.at(std::get<const domain::BusRoute*>(data_edge.obj)->name));
-					*proto_data_edge.mutable_bus() = std::move(bus_name);
+					proto_data_edge.mutable_bus()->set_name(std::get<const domain::BusRoute*>(data_edge.obj)->id);
 				}
 				proto_data_edge.set_weight(data_edge.weight);
 				proto_data_edge.set_spun_count(data_edge.spun_count);
@@ -415,49 +546,40 @@ namespace transport_directory {
 				return data_edge;
 			}
 
-			transport_catalogue_serialize::EdgeIdData CreateProtoPairEdgeIdData(
-				const std::pair<transport_router::EdgeId, transport_router::TransportRouter::DataEdge>& edge_id_data, 
-				const transport_catalogue::TransportCatalogue& guide) {
-
-				transport_catalogue_serialize::EdgeIdData proto_edge_id_data;
-				proto_edge_id_data.set_edge_id(edge_id_data.first);
-				*proto_edge_id_data.mutable_data_edge() = CreateProtoDataEdge(edge_id_data.second, guide);
-				return proto_edge_id_data;
-			}
-
-			std::pair<transport_router::EdgeId, transport_router::TransportRouter::DataEdge> GetPairEdgeIdData(
-				const transport_catalogue_serialize::EdgeIdData& proto_edge_id_data, const transport_catalogue::TransportCatalogue& guide) {
-
-				return std::pair<transport_router::EdgeId, transport_router::TransportRouter::DataEdge>{ proto_edge_id_data.edge_id(), GetDataEdge(proto_edge_id_data.data_edge(), guide) };
-			}
-
 			transport_catalogue_serialize::DataForTransportRouter CreateProtoDataForTransportRouter(
-				const json_reader::DownloadedDataForTransportRouter& data) {
+				json_reader::DownloadedDataForTransportRouter&& data) {
 
 				transport_catalogue_serialize::DataForTransportRouter proto_data;
 				*proto_data.mutable_guide() = CreateProtoTransportCatalogue(data.guide);
 				*proto_data.mutable_render_settings() = CreateProtoRenderSettings(data.render_settings);
 				*proto_data.mutable_routing_settings() = CreateProtoRoutingSettings(data.routing_settings);
+				proto_data.set_weight_units_per_minute(transport_router::WEIGHT_UNITS_PER_MINUTE);
 
 				if (data.data_for_router) {
 					*proto_data.mutable_graph() = CreateProtoGraph(*data.data_for_router->graph);
 
-					const graph::Router<transport_router::Weight>::RoutesInternalData& 
-						routes_internal_data = data.data_for_router->data_of_router;
-					for (const auto& elem : routes_internal_data) {
-						*proto_data.add_data_of_router() = CreateProtoArrayRouteInternalData(elem);
+					if (data.routing_settings.router_type == transport_router::TransportRouter::RouterType::ALL_PAIRS) {
+						*proto_data.mutable_data_of_router() = CreateProtoRoutesInternalData(std::move(data.data_for_router->data_of_router));
 					}
-
-					const std::unordered_map<const domain::Stop*, transport_router::EdgeId>& 
-						stop_id = data.data_for_router->stop_id;
-					for (const auto& elem : stop_id) {
-						*proto_data.add_stop_id() = CreateProtoPairStopId(elem, data.guide);
+					if (data.routing_settings.router_type == transport_router::TransportRouter::RouterType::CONTRACTION_HIERARCHY
+						|| data.routing_settings.router_type == transport_router::TransportRouter::RouterType::HUB_LABELS) {
+						*proto_data.mutable_contraction_hierarchy() = CreateProtoContractionHierarchy(data.data_for_router->hierarchy);
+					}
+					if (data.routing_settings.router_type == transport_router::TransportRouter::RouterType::HUB_LABELS) {
+						*proto_data.mutable_forward_labels() = CreateProtoHubLabels(data.data_for_router->hub_labels.forward);
+						*proto_data.mutable_backward_labels() = CreateProtoHubLabels(data.data_for_router->hub_labels.backward);
+					}
+					if (data.routing_settings.router_type == transport_router::TransportRouter::RouterType::CUSTOMIZABLE_CONTRACTION_HIERARCHY) {
+						const std::vector<size_t>& ranks = data.data_for_router->ranks;
+						proto_data.mutable_customizable_contraction_hierarchy()->mutable_ranks()->Add(ranks.begin(), ranks.end());
 					}
 
-					const std::unordered_map<transport_router::EdgeId, transport_router::TransportRouter::DataEdge>&
-						edge_id_data = data.data_for_router->edge_id_data;
-					for (const auto& elem : edge_id_data) {
-						*proto_data.add_edge_id_data() = CreateProtoPairEdgeIdData(elem, data.guide);
+					const std::vector<transport_router::EdgeId>& stop_wait_edges = data.data_for_router->stop_wait_edges;
+					proto_data.mutable_stop_wait_edges()->Add(stop_wait_edges.begin(), stop_wait_edges.end());
+
+					proto_data.mutable_edge_data()->Reserve(static_cast<int>(data.data_for_router->edge_data.size()));
+					for (const auto& data_edge : data.data_for_router->edge_data) {
+						*proto_data.add_edge_data() = CreateProtoDataEdge(data_edge);
 					}
 				}
 
@@ -465,7 +587,12 @@ namespace transport_directory {
 			}
 
 			json_reader::DownloadedDataForTransportRouter GetDataForTransportRouter(
-				const transport_catalogue_serialize::DataForTransportRouter& proto_data) {
+				transport_catalogue_serialize::DataForTransportRouter&& proto_data) {
+
+				const double weight_units_per_minute = proto_data.weight_units_per_minute() == 0 ? 1.0 : proto_data.weight_units_per_minute();
+				if (weight_units_per_minute != transport_router::WEIGHT_UNITS_PER_MINUTE) {
+					throw std::invalid_argument("Base was made with other units of weights");
+				}
 
 				json_reader::DownloadedDataForTransportRouter data;
 				data.guide = GetTransportCatalogue(proto_data.guide());
@@ -475,26 +602,33 @@ namespace transport_directory {
 				transport_router::TransportRouter::DownloadedData downloaded_data_for_router;
 				downloaded_data_for_router.graph = std::make_unique<transport_router::Graph>(GetGraph(proto_data.graph()));
 				
-				downloaded_data_for_router.data_of_router.reserve(proto_data.data_of_router_size());
-				for (int i = 0; i < proto_data.data_of_router_size(); ++i) {
-					downloaded_data_for_router.data_of_router.emplace_back(GetArrayRouteInternalData(proto_data.data_of_router(i)));
+				if (proto_data.has_data_of_router()) {
+					downloaded_data_for_router.data_of_router = GetRoutesInternalData(std::move(*proto_data.mutable_data_of_router()));
+				}
+				if (proto_data.has_contraction_hierarchy()) {
+					downloaded_data_for_router.hierarchy = GetContractionHierarchy(proto_data.contraction_hierarchy());
+				}
+				if (proto_data.has_customizable_contraction_hierarchy()) {
+					const auto& proto_ranks = proto_data.customizable_contraction_hierarchy().ranks();
+					downloaded_data_for_router.ranks.assign(proto_ranks.begin(), proto_ranks.end());
 				}
-				for (int i = 0; i < proto_data.stop_id_size(); ++i) {
-					const auto [ptr_to_stop, edge_id] = GetPairStopId(proto_data.stop_id(i), data.guide);
-					downloaded_data_for_router.stop_id.emplace(ptr_to_stop, edge_id);
+				if (proto_data.has_forward_labels() && proto_data.has_backward_labels()) {
+					downloaded_data_for_router.hub_labels.forward = GetHubLabels(proto_data.forward_labels());
+					downloaded_data_for_router.hub_labels.backward = GetHubLabels(proto_data.backward_labels());
 				}
+				downloaded_data_for_router.stop_wait_edges.assign(proto_data.stop_wait_edges().begin(), proto_data.stop_wait_edges().end());
 
-				for (int i = 0; i < proto_data.edge_id_data_size(); ++i) {
-					const auto [edge_id, data_edge] = GetPairEdgeIdData(proto_data.edge_id_data(i), data.guide);
-					downloaded_data_for_router.edge_id_data.emplace(edge_id, data_edge);
+				downloaded_data_for_router.edge_data.reserve(proto_data.edge_data_size());
+				for (int i = 0; i < proto_data.edge_data_size(); ++i) {
+					downloaded_data_for_router.edge_data.push_back(GetDataEdge(proto_data.edge_data(i), data.guide));
 				}
 				data.data_for_router = std::make_unique<transport_router::TransportRouter::DownloadedData>(std::move(downloaded_data_for_router));
 				return data;
 			}
 		}// namespace detail
 
-		bool SaveDataForTransportRouter(std::ostream& out, const json_reader::DownloadedDataForTransportRouter& data) {
-			transport_catalogue_serialize::DataForTransportRouter proto_data = detail::CreateProtoDataForTransportRouter(data);
+		bool SaveDataForTransportRouter(std::ostream& out, json_reader::DownloadedDataForTransportRouter&& data) {
+			transport_catalogue_serialize::DataForTransportRouter proto_data = detail::CreateProtoDataForTransportRouter(std::move(data));
 			return proto_data.SerializeToOstream(&out);
 		}
 
@@ -503,7 +637,7 @@ namespace transport_directory {
 			if (!proto_data.ParseFromIstream(&ifs)) {
 				return {};
 			}
-			return detail::GetDataForTransportRouter(proto_data);
+			return detail::GetDataForTransportRouter(std::move(proto_data));
 		}
 
 	}// namespace serialization_tr_catalogue
@@ -37,10 +37,8 @@ namespace transport_directory {
 			};
 
 			transport_catalogue_serialize::Stop CreateProtoStop(const domain::Stop& stop);
-			transport_catalogue_serialize::BusRoute CreateProtoBusRoute(const domain::BusRoute& bus_route,
-				const std::unordered_map<std::string_view, size_t>& stops_indexes);
-			transport_catalogue_serialize::Distance CreateProtoDistance(const std::pair<const domain::Stop*, const domain::Stop*>& stops,
-				int distance, const std::unordered_map<std::string_view, size_t>& stops_indexes);
+			transport_catalogue_serialize::BusRoute CreateProtoBusRoute(const domain::BusRoute& bus_route, const transport_catalogue::BusStat* stat);
+			transport_catalogue_serialize::Distance CreateProtoDistance(const transport_catalogue::RoadDistance& distance);
 			transport_catalogue_serialize::TransportCatalogue CreateProtoTransportCatalogue(const transport_catalogue::TransportCatalogue& guide);
 
 			//--------------------------------- Get TransportCatalogue from Protobuf-object --------------------------------------
@@ -66,12 +64,16 @@ namespace transport_directory {
 
 			//------------------------------- Create Protobuf-object from RoutingSettings ------------------------------------------
 
-			transport_catalogue_serialize::RoutingSettings CreateProtoRoutingSettings(
+			transport_catalogue_serialize::RouterType CreateProtoRouterType(transport_router::TransportRouter::RouterType router_type);
+			transport_catalogue_serialize::GraphModel CreateProtoGraphModel(transport_router::TransportRouter::GraphModel graph_model);
+						transport_catalogue_serialize::RoutingSettings CreateProtoRoutingSettings(
 				const transport_router::TransportRouter::RoutingSettings& routing_settings);
 
 			//------------------------------- Get RoutingSettings from Protobuf-object ---------------------------------------------
 
-			transport_router::TransportRouter::RoutingSettings GetRoutingSettings(
+			transport_router::TransportRouter::RouterType GetRouterType(transport_catalogue_serialize::RouterType proto_router_type);
+			transport_router::TransportRouter::GraphModel GetGraphModel(transport_catalogue_serialize::GraphModel proto_graph_model);
+						transport_router::TransportRouter::RoutingSettings GetRoutingSettings(
 				const transport_catalogue_serialize::RoutingSettings proto_routing_settings);
 
 			//------------------------------ Create Protobuf-object from Graph -----------------------------------------------------
@@ -86,45 +88,37 @@ namespace transport_directory {
 
 			//------------------------------ Create Protobuf-objects from TransporRouter::DownloadedData -----------------------------
 
-			transport_catalogue_serialize::RouteInternalData CreateProtoRouteInternalData(
-				const graph::Router<transport_router::Weight>::RouteInternalData& route_internal_data);
-			transport_catalogue_serialize::ArrayRouteInternalData CreateProtoArrayRouteInternalData(
-				std::vector<std::optional<graph::Router<transport_router::Weight>::RouteInternalData>> array_route_internal_data);
-			transport_catalogue_serialize::StopId CreateProtoPairStopId(
-				const std::pair<const domain::Stop*, transport_router::EdgeId>& stop_id,
-				const transport_catalogue::TransportCatalogue& guide);
-			transport_catalogue_serialize::DataEdge CreateProtoDataEdge(const transport_router::TransportRouter::DataEdge& data_edge, 
-				const transport_catalogue::TransportCatalogue& guide);
-			transport_catalogue_serialize::EdgeIdData CreateProtoPairEdgeIdData(
-				const std::pair<transport_router::EdgeId, transport_router::TransportRouter::DataEdge>& edge_id_data, 
-				const transport_catalogue::TransportCatalogue& guide);
+			// Arrays of the table are freed as soon as they are copied
+			transport_catalogue_serialize::RoutesInternalData CreateProtoRoutesInternalData(
+				graph::Router<transport_router::Weight>::RoutesInternalData&& routes_internal_data);
+			transport_catalogue_serialize::ContractionHierarchy CreateProtoContractionHierarchy(
+				const graph::ContractionHierarchy<transport_router::Weight>::HierarchyData& hierarchy);
+			transport_catalogue_serialize::DataEdge CreateProtoDataEdge(const transport_router::TransportRouter::DataEdge& data_edge);
 			
 			//----------------------------- Get TransporRouter::DownloadedData from Protobuf_objects -----------------------------------
 			
-			graph::Router<transport_router::Weight>::RouteInternalData GetRouteInternalData(
-				const transport_catalogue_serialize::RouteInternalData& proto_route_internal_data);
-			std::vector<std::optional<graph::Router<transport_router::Weight>::RouteInternalData>> GetArrayRouteInternalData(
-				const transport_catalogue_serialize::ArrayRouteInternalData& proto_array_route_internal_data);
-			std::pair<const domain::Stop*, transport_router::EdgeId> GetPairStopId(transport_catalogue_serialize::StopId proto_stop_id,
-				const transport_catalogue::TransportCatalogue& guide);
+			// Byte arrays of the table are released from the message as soon as they are copied
+			graph::Router<transport_router::Weight>::RoutesInternalData GetRoutesInternalData(
+				transport_catalogue_serialize::RoutesInternalData&& proto_routes_internal_data);
+			graph::ContractionHierarchy<transport_router::Weight>::HierarchyData GetContractionHierarchy(
+				const transport_catalogue_serialize::ContractionHierarchy& proto_hierarchy);
 			transport_router::TransportRouter::DataEdge GetDataEdge(const transport_catalogue_serialize::DataEdge& proto_data_edge,
 				const transport_catalogue::TransportCatalogue& guide);
-			std::pair<transport_router::EdgeId, transport_router::TransportRouter::DataEdge> GetPairEdgeIdData(
-				const transport_catalogue_serialize::EdgeIdData& proto_edge_id_data, const transport_catalogue::TransportCatalogue& guide);
 
 			//--------------------------- Create general Protobuf-object from DownloadedDataForTransportRouter --------------------------
 
+			// The data of the router is moved out of data
 			transport_catalogue_serialize::DataForTransportRouter CreateProtoDataForTransportRouter(
-				const json_reader::DownloadedDataForTransportRouter& data);
+				json_reader::DownloadedDataForTransportRouter&& data);
 
 			//--------------------------- Get DownloadedDataForTransportRouter from Protobuf-object
 			
 			json_reader::DownloadedDataForTransportRouter GetDataForTransportRouter(
-				const transport_catalogue_serialize::DataForTransportRouter& proto_data);
+				transport_catalogue_serialize::DataForTransportRouter&& proto_data);
 
 		}//namespace detail
 
-		bool SaveDataForTransportRouter(std::ostream& out, const json_reader::DownloadedDataForTransportRouter& data);
+		bool SaveDataForTransportRouter(std::ostream& out, json_reader::DownloadedDataForTransportRouter&& data);
 
 		transport_directory::json_reader::DownloadedDataForTransportRouter LoadDataForTransportRouter(std::istream& ifs);
 
@@ -0,0 +1,52 @@
+#pragma once
+#include <cstddef>
+#include <cstring>
+#include <memory>
+#include <string_view>
+#include <vector>
+
+namespace memory {
+
+    // Хранилище строк в блоках по BLOCK_SIZE байт: вместо отдельного выделения памяти на каждую строку
+    // строки дописываются в текущий блок. Строки не перемещаются, поэтому string_view на них
+    // действительны, пока жива арена, в том числе после её перемещения
+    class StringArena {
+    public:
+        StringArena() = default;
+
+        StringArena(const StringArena&) = delete;
+        StringArena& operator=(const StringArena&) = delete;
+        StringArena(StringArena&&) = default;
+        StringArena& operator=(StringArena&&) = default;
+
+        std::string_view Store(std::string_view str) {
+            if (str.empty()) {
+                return {};
+            }
+            char* place = nullptr;
+            if (str.size() > BLOCK_SIZE / 4) {
+                // длинная строка получает свой блок, текущий блок продолжает заполняться
+                place = blocks_.emplace_back(std::make_unique<char[]>(str.size())).get();
+            }
+            else {
+                if (free_size_ < str.size()) {
+                    free_ = blocks_.emplace_back(std::make_unique<char[]>(BLOCK_SIZE)).get();
+                    free_size_ = BLOCK_SIZE;
+                }
+                place = free_;
+                free_ += str.size();
+                free_size_ -= str.size();
+            }
+            std::memcpy(place, str.data(), str.size());
+            return { place, str.size() };
+        }
+
+    private:
+        static constexpr size_t BLOCK_SIZE = 64 * 1024;
+
+        std::vector<std::unique_ptr<char[]>> blocks_;
+        char* free_ = nullptr;
+        size_t free_size_ = 0;
+    };
+
+}  // namespace memory
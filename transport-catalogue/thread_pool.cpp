@@ -0,0 +1,102 @@
+#include "thread_pool.h"
+
+#include <algorithm>
+#include <exception>
+#include <utility>
+
+namespace parallel {
+
+    ThreadPool::ThreadPool(size_t thread_count) {
+        if (thread_count == 0) {
+            thread_count = std::max<size_t>(std::thread::hardware_concurrency(), 1);
+        }
+        workers_.reserve(thread_count - 1);
+        for (size_t i = 1; i < thread_count; ++i) {
+            workers_.emplace_back([this] { WorkerLoop(); });
+        }
+    }
+
+    ThreadPool::~ThreadPool() {
+        {
+            std::lock_guard lock(mutex_);
+            stopped_ = true;
+        }
+        job_started_.notify_all();
+        for (auto& worker : workers_) {
+            worker.join();
+        }
+    }
+
+    size_t ThreadPool::GetThreadCount() const {
+        return workers_.size() + 1;
+    }
+
+    void ThreadPool::ParallelFor(size_t count, const std::function<void(size_t)>& task) {
+        if (count == 0) {
+            return;
+        }
+        if (workers_.empty() || count == 1) {
+            for (size_t index = 0; index < count; ++index) {
+                task(index);
+            }
+            return;
+        }
+        {
+            std::lock_guard lock(mutex_);
+            task_ = &task;
+            task_count_ = count;
+            next_task_ = 0;
+            exception_ = nullptr;
+            busy_workers_ = workers_.size();
+            ++job_generation_;
+        }
+        job_started_.notify_all();
+        RunTasks();
+
+        std::unique_lock lock(mutex_);
+        job_finished_.wait(lock, [this] { return busy_workers_ == 0; });
+        task_ = nullptr;
+        if (exception_) {
+            std::rethrow_exception(std::exchange(exception_, nullptr));
+        }
+    }
+
+    void ThreadPool::WorkerLoop() {
+        size_t seen_generation = 0;
+        while (true) {
+            {
+                std::unique_lock lock(mutex_);
+                job_started_.wait(lock, [this, seen_generation] {
+                    return stopped_ || job_generation_ != seen_generation;
+                });
+                if (stopped_) {
+                    return;
+                }
+                seen_generation = job_generation_;
+            }
+            RunTasks();
+            {
+                std::lock_guard lock(mutex_);
+                --busy_workers_;
+            }
+            job_finished_.notify_one();
+        }
+    }
+
+    void ThreadPool::RunTasks() {
+        for (size_t index = next_task_++; index < task_count_; index = next_task_++) {
+            try {
+                (*task_)(index);
+            }
+            catch (...) {
+                std::lock_guard lock(mutex_);
+                if (!exception_) {
+                    exception_ = std::current_exception();
+                }
+                // Оставшиеся задания не выполняются
+                next_task_ = task_count_;
+            }
+        }
+    }
+
+}  // namespace parallel
@@ -0,0 +1,50 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace parallel {
+
+    // Пул потоков для параллельной обработки независимых заданий с номерами [0, count).
+    // Вызывающий поток тоже участвует в работе, поэтому пул из одного потока
+    // выполняет задания последовательно, не создавая дополнительных потоков.
+    class ThreadPool {
+    public:
+        // thread_count == 0 означает число аппаратных потоков
+        explicit ThreadPool(size_t thread_count = 0);
+
+        ThreadPool(const ThreadPool&) = delete;
+        ThreadPool& operator=(const ThreadPool&) = delete;
+
+        ~ThreadPool();
+
+        size_t GetThreadCount() const;
+
+        // Вызывает task(index) для каждого index из [0, count) и дожидается завершения всех вызовов.
+        // Исключение, выброшенное заданием, передаётся вызывающему потоку.
+        void ParallelFor(size_t count, const std::function<void(size_t)>& task);
+
+    private:
+        void WorkerLoop();
+
+        void RunTasks();
+
+        std::vector<std::thread> workers_;
+        std::mutex mutex_;
+        std::condition_variable job_started_;
+        std::condition_variable job_finished_;
+        const std::function<void(size_t)>* task_ = nullptr;
+        size_t task_count_ = 0;
+        std::atomic<size_t> next_task_{ 0 };
+        size_t job_generation_ = 0;
+        size_t busy_workers_ = 0;
+        std::exception_ptr exception_;
+        bool stopped_ = false;
+    };
+
+}  // namespace parallel
@@ -1,6 +1,8 @@
 #include "transport_catalogue.h"
+#include "thread_pool.h"
 
-#include <unordered_set>
+#include <algorithm>
+#include <stdexcept>
 #include <iomanip>
 
 namespace transport_directory {
@@ -40,38 +42,104 @@ namespace transport_directory {
 			return *this;
 		}
 
-		StatForStop::StatForStop(std::string_view name_stop, const std::set<std::string_view>* buses)
+		StatForStop::StatForStop(std::string_view name_stop, std::optional<StopBuses> buses)
 			: name_stop_(name_stop),
 			buses_(buses)
 		{}
 
-		void TransportCatalogue::AddStop(std::string name_stop, geo::Coordinates coordinates) {
-			auto& stop = stops_.emplace_back(std::move(name_stop), coordinates);
-			index_stops_.emplace(stop.name, &stop);
-			stop_buses_[stop.name];
+		void TransportCatalogue::Reserve(size_t stop_count, size_t bus_count, size_t route_stop_count) {
+			ReserveStops(stop_count);
+			bus_routes_.reserve(bus_count);
+			ReserveRouteStops(route_stop_count);
 		}
 
-		void TransportCatalogue::AddBusRoute(std::string name_bus, std::vector<std::string> stops, bool is_roundtrip) {
-			std::vector<const domain::Stop*> route(stops.size());
-			auto& bus = bus_routes_.emplace_back(std::move(name_bus), std::move(route));
-			for (size_t i = 0; i < bus.route.size(); ++i) {
-				bus.route[i] = index_stops_[stops[i]];
-				stop_buses_[stops[i]].insert(bus.name);
+		void TransportCatalogue::AddStop(std::string_view name_stop, geo::Coordinates coordinates) {
+			if (stops_.size() == stops_.capacity()) {
+				ReserveStops(std::max<size_t>(2 * stops_.size(), 16));
 			}
+			auto& stop = stops_.emplace_back(InternName(name_stop), coordinates, static_cast<domain::StopId>(stops_.size()));
+			index_stops_.emplace(stop.name, stop.id);
+			stop_bus_offsets_.clear();
+			distance_offsets_.clear();
+		}
+
+		void TransportCatalogue::AddBusRoute(std::string_view name_bus, const std::vector<std::string>& stops, bool is_roundtrip) {
+			std::vector<domain::StopId> stop_ids(stops.size());
+			for (size_t i = 0; i < stops.size(); ++i) {
+				stop_ids[i] = index_stops_.at(stops[i]);
+			}
+			if (route_stops_.size() + stops.size() > route_stops_.capacity()) {
+				ReserveRouteStops(std::max(2 * route_stops_.capacity(), route_stops_.size() + stops.size()));
+			}
+			const size_t offset = route_stops_.size();
+			for (domain::StopId stop_id : stop_ids) {
+				route_stops_.push_back(&stops_[stop_id]);
+			}
+			const domain::RouteStops route(route_stops_.data() + offset, route_stops_.data() + route_stops_.size());
+			auto& bus = bus_routes_.emplace_back(InternName(name_bus), route, static_cast<domain::BusId>(bus_routes_.size()));
 			bus.is_roundtrip = is_roundtrip;
-			index_buses_.emplace(bus.name, &bus);
+			index_buses_.emplace(bus.name, bus.id);
+			bus_stats_.clear();
+			stop_bus_offsets_.clear();
 		}
 
 		void TransportCatalogue::SetDistance(const domain::Stop* from, const domain::Stop* to, int distance) {
-			distances_.emplace(std::pair<const domain::Stop*, const domain::Stop*>{ from, to }, distance);
+			distances_.push_back({ from->id, to->id, distance });
+			bus_stats_.clear();
+			distance_offsets_.clear();
+		}
+
+		void TransportCatalogue::BuildDistances() {
+			// the set direction goes before the reverse one, so a stable sort keeps the first distance
+			// set in the direction and then the first distance set in the reverse direction
+			std::vector<RoadDistance> distances;
+			distances.reserve(2 * distances_.size());
+			for (const RoadDistance& distance : distances_) {
+				distances.push_back(distance);
+			}
+			for (const RoadDistance& distance : distances_) {
+				distances.push_back({ distance.to, distance.from, distance.distance });
+			}
+			std::stable_sort(distances.begin(), distances.end(), [](const RoadDistance& lhs, const RoadDistance& rhs) {
+				return std::pair{ lhs.from, lhs.to } < std::pair{ rhs.from, rhs.to };
+				});
+			distances.erase(std::unique(distances.begin(), distances.end(), [](const RoadDistance& lhs, const RoadDistance& rhs) {
+				return lhs.from == rhs.from && lhs.to == rhs.to;
+				}), distances.end());
+
+			std::vector<uint32_t> offsets(stops_.size() + 1, 0);
+			std::vector<std::pair<domain::StopId, int>> neighbour_distances;
+			neighbour_distances.reserve(distances.size());
+			for (const RoadDistance& distance : distances) {
+				++offsets[distance.from + 1];
+				neighbour_distances.emplace_back(distance.to, distance.distance);
+			}
+			for (size_t i = 1; i < offsets.size(); ++i) {
+				offsets[i] += offsets[i - 1];
+			}
+			distance_offsets_ = std::move(offsets);
+			neighbour_distances_ = std::move(neighbour_distances);
 		}
 
 		int TransportCatalogue::GetDistance(const domain::Stop* from, const domain::Stop* to) const {
-			auto it = distances_.find({ from, to });
-			if (it == distances_.end()) {
-				return distances_.at({ to, from });
+			if (distance_offsets_.size() != stops_.size() + 1) {
+				throw std::logic_error("Adjacency arrays of distances aren't built");
 			}
-			return it->second;
+			// branchless binary search for the last neighbour with id not greater than to
+			const std::pair<domain::StopId, int>* first = neighbour_distances_.data() + distance_offsets_[from->id];
+			size_t length = distance_offsets_[from->id + 1] - distance_offsets_[from->id];
+			if (length == 0) {
+				throw std::out_of_range("Distance between stops isn't set");
+			}
+			while (length > 1) {
+				const size_t half = length / 2;
+				first = first[half].first <= to->id ? first + half : first;
+				length -= half;
+			}
+			if (first->first != to->id) {
+				throw std::out_of_range("Distance between stops isn't set");
+			}
+			return first->second;
 		}
 
 		const domain::BusRoute* TransportCatalogue::SearchRoute(std::string_view name_bus) const {
@@ -79,7 +147,7 @@ namespace transport_directory {
 			if (it == index_buses_.end()) {
 				return nullptr;
 			}
-			return it->second;
+			return &bus_routes_[it->second];
 		}
 
 		const domain::Stop* TransportCatalogue::SearchStop(std::string_view name_stop) const {
@@ -87,43 +155,65 @@ namespace transport_directory {
 			if (it == index_stops_.end()) {
 				return nullptr;
 			}
-			return it->second;
+			return &stops_[it->second];
 		}
 
-		const std::deque<domain::BusRoute>& TransportCatalogue::GetBusRoutes() const {
+		const std::vector<domain::BusRoute>& TransportCatalogue::GetBusRoutes() const {
 			return bus_routes_;
 		}
 
-		const std::deque<domain::Stop>& TransportCatalogue::GetStops() const {
+		const std::vector<domain::Stop>& TransportCatalogue::GetStops() const {
 			return stops_;
 		}
 
-		const std::unordered_map<std::pair<const domain::Stop*, const domain::Stop*>, int, TransportCatalogue::DistancesHasher>& TransportCatalogue::GetDistances() const {
+		const std::vector<RoadDistance>& TransportCatalogue::GetDistances() const {
 			return distances_;
 		}
 
-		const std::unordered_map<std::string_view, size_t>& TransportCatalogue::GetIndexedOfStops() const {
-			if (!indexes_of_stops) {
-				indexes_of_stops = std::make_unique<std::unordered_map<std::string_view, size_t>>();
-				for (size_t i = 0; i < stops_.size(); ++i) {
-					indexes_of_stops->emplace(stops_[i].name, i);
-				}
+		StopBuses TransportCatalogue::GetStopBuses(domain::StopId id) const {
+			if (stop_bus_offsets_.size() != stops_.size() + 1) {
+				throw std::logic_error("Index of buses of stops isn't built");
 			}
-			return *indexes_of_stops;
+			const domain::BusRoute* const* buses = stop_buses_.data();
+			return StopBuses(buses + stop_bus_offsets_[id], buses + stop_bus_offsets_[id + 1]);
 		}
 
-		const std::unordered_map<std::string_view, size_t>& TransportCatalogue::GetIndexesOfBusRoutes() const {
-			if (!indexes_of_bus_routes) {
-				indexes_of_bus_routes = std::make_unique<std::unordered_map<std::string_view, size_t>>();
-				for (size_t i = 0; i < bus_routes_.size(); ++i) {
-					indexes_of_bus_routes->emplace(bus_routes_[i].name, i);
-				}
+		std::string_view TransportCatalogue::InternName(std::string_view name) {
+			if (auto it = index_stops_.find(name); it != index_stops_.end()) {
+				return it->first;
+			}
+			if (auto it = index_buses_.find(name); it != index_buses_.end()) {
+				return it->first;
 			}
-			return *indexes_of_bus_routes;
+			return names_.Store(name);
 		}
 
-		size_t TransportCatalogue::DistancesHasher::operator()(const std::pair<const domain::Stop*, const domain::Stop*>& p) const {
-			return hasher((uintptr_t)p.first) + 47 * hasher((uintptr_t)p.second);
+		void TransportCatalogue::ReserveStops(size_t count) {
+			if (count <= stops_.capacity()) {
+				return;
+			}
+			std::vector<domain::Stop> stops;
+			stops.reserve(count);
+			stops.assign(stops_.begin(), stops_.end());
+			// the old stops are alive here, so ids are read through the old pointers
+			for (const domain::Stop*& stop : route_stops_) {
+				stop = &stops[stop->id];
+			}
+			stops_ = std::move(stops);
+		}
+
+		void TransportCatalogue::ReserveRouteStops(size_t count) {
+			if (count <= route_stops_.capacity()) {
+				return;
+			}
+			std::vector<const domain::Stop*> route_stops;
+			route_stops.reserve(count);
+			route_stops.assign(route_stops_.begin(), route_stops_.end());
+			for (domain::BusRoute& bus : bus_routes_) {
+				const auto offset = bus.route.begin() - route_stops_.data();
+				bus.route = domain::RouteStops(route_stops.data() + offset, route_stops.data() + offset + bus.route.size());
+			}
+			route_stops_ = std::move(route_stops);
 		}
 
 		StatBusRoute TransportCatalogue::RequestStatBusRoute(std::string_view name_bus) const {
@@ -131,30 +221,108 @@ namespace transport_directory {
 			if (!bus_route_ptr) {
 				return StatBusRoute(std::string(name_bus));
 			}
-			const domain::BusRoute& bus_route = *bus_route_ptr;
-			size_t count_stops = bus_route.route.size();
-			std::unordered_set<const domain::Stop*> unique_stops;
-			unique_stops.insert(bus_route.route[0]);
+			const BusStat stat = bus_route_ptr->id < bus_stats_.size() ? bus_stats_[bus_route_ptr->id] : ComputeBusStat(*bus_route_ptr);
+			return StatBusRoute().SetName(std::string(name_bus)).SetCountStops(stat.stop_count)
+				.SetCountUniqueStops(stat.unique_stop_count).SetRouteLength(stat.route_length)
+				.SetCurvate(stat.curvature).SetBusRoute(bus_route_ptr);
+		}
+
+		BusStat TransportCatalogue::ComputeBusStat(const domain::BusRoute& bus_route) const {
+			BusStat stat;
+			stat.stop_count = static_cast<uint32_t>(bus_route.route.size());
+			std::vector<domain::StopId> unique_stops;
+			unique_stops.reserve(bus_route.route.size());
+			for (const domain::Stop* stop : bus_route.route) {
+				unique_stops.push_back(stop->id);
+			}
+			std::sort(unique_stops.begin(), unique_stops.end());
+			stat.unique_stop_count = static_cast<uint32_t>(std::unique(unique_stops.begin(), unique_stops.end()) - unique_stops.begin());
 			double distance = 0.0;
-			int route_length = 0;
 			for (size_t i = 1; i < bus_route.route.size(); ++i) {
-				unique_stops.insert(bus_route.route[i]);
 				distance += ComputeDistance(bus_route.route[i - 1]->coordinates, bus_route.route[i]->coordinates);
-				route_length += GetDistance(bus_route.route[i - 1], bus_route.route[i]);
+				stat.route_length += GetDistance(bus_route.route[i - 1], bus_route.route[i]);
+			}
+			stat.curvature = static_cast<double>(stat.route_length) / distance;
+			return stat;
+		}
+
+		void TransportCatalogue::ComputeBusStats(size_t thread_count) {
+			std::vector<BusStat> bus_stats(bus_routes_.size());
+			parallel::ThreadPool pool(thread_count);
+			pool.ParallelFor(bus_routes_.size(), [this, &bus_stats](size_t id) {
+				bus_stats[id] = ComputeBusStat(bus_routes_[id]);
+				});
+			bus_stats_ = std::move(bus_stats);
+		}
+
+		void TransportCatalogue::SetBusStats(std::vector<BusStat> bus_stats) {
+			if (bus_stats.size() != bus_routes_.size()) {
+				throw std::invalid_argument("Statistics don't match buses of the catalogue");
+			}
+			bus_stats_ = std::move(bus_stats);
+		}
+
+		const std::vector<BusStat>& TransportCatalogue::GetBusStats() const {
+			return bus_stats_;
+		}
+
+		void TransportCatalogue::BuildStopBuses() {
+			std::vector<const domain::BusRoute*> buses;
+			buses.reserve(bus_routes_.size());
+			for (const domain::BusRoute& bus : bus_routes_) {
+				buses.push_back(&bus);
+			}
+			std::sort(buses.begin(), buses.end(), [](const domain::BusRoute* lhs, const domain::BusRoute* rhs) {
+				return lhs->name < rhs->name;
+				});
+			// buses are put in the order of names, a bus passing a stop several times is put once
+			std::vector<const domain::BusRoute*> last_buses(stops_.size(), nullptr);
+			std::vector<uint32_t> offsets(stops_.size() + 1, 0);
+			for (const domain::BusRoute* bus : buses) {
+				for (const domain::Stop* stop : bus->route) {
+					if (last_buses[stop->id] != bus) {
+						last_buses[stop->id] = bus;
+						++offsets[stop->id + 1];
+					}
+				}
+			}
+			for (size_t i = 1; i < offsets.size(); ++i) {
+				offsets[i] += offsets[i - 1];
+			}
+			std::vector<const domain::BusRoute*> stop_buses(offsets.back());
+			std::vector<uint32_t> positions(offsets.begin(), offsets.end() - 1);
+			last_buses.assign(stops_.size(), nullptr);
+			for (const domain::BusRoute* bus : buses) {
+				for (const domain::Stop* stop : bus->route) {
+					if (last_buses[stop->id] != bus) {
+						last_buses[stop->id] = bus;
+						stop_buses[positions[stop->id]++] = bus;
+					}
+				}
+			}
+			stop_bus_offsets_ = std::move(offsets);
+			stop_buses_ = std::move(stop_buses);
+		}
+
+		void TransportCatalogue::SetStopBuses(std::vector<uint32_t> offsets, const std::vector<domain::BusId>& bus_ids) {
+			if (offsets.size() != stops_.size() + 1 || offsets.front() != 0 || offsets.back() != bus_ids.size()
+				|| !std::is_sorted(offsets.begin(), offsets.end())) {
+				throw std::invalid_argument("Index of buses doesn't match stops of the catalogue");
+			}
+			std::vector<const domain::BusRoute*> stop_buses(bus_ids.size());
+			for (size_t i = 0; i < bus_ids.size(); ++i) {
+				stop_buses[i] = &bus_routes_.at(bus_ids[i]);
 			}
-			size_t count_unique_stops = unique_stops.size();
-			double curvature = static_cast<double>(route_length) / distance;
-			return StatBusRoute().SetName(std::string(name_bus)).SetCountStops(count_stops)
-				.SetCountUniqueStops(count_unique_stops).SetRouteLength(route_length)
-				.SetCurvate(curvature).SetBusRoute(bus_route_ptr);
+			stop_bus_offsets_ = std::move(offsets);
+			stop_buses_ = std::move(stop_buses);
 		}
 
 		StatForStop TransportCatalogue::RequestStatForStop(std::string_view name_stop) const {
-			if (!SearchStop(name_stop)) {
-				return StatForStop(name_stop, nullptr);
+			const domain::Stop* stop = SearchStop(name_stop);
+			if (!stop) {
+				return StatForStop(name_stop, std::nullopt);
 			}
-			auto it = stop_buses_.find(name_stop);
-			return StatForStop(name_stop, &(it->second));
+			return StatForStop(name_stop, GetStopBuses(stop->id));
 		}
 
 	}//end namespace transport_catalogue
@@ -1,14 +1,14 @@
 #pragma once
 #include "domain.h"
+#include "string_arena.h"
 
 #include <unordered_map>
 #include <string>
 #include <string_view>
-#include <deque>
-#include <set>
+#include <optional>
 #include <cstdint>
-#include <memory>
 #include <type_traits>
+#include <vector>
 
 namespace transport_directory {
 	namespace transport_catalogue {
@@ -33,59 +33,120 @@ namespace transport_directory {
 			const domain::BusRoute* bus_route_ = nullptr;
 		};
 
+		// Statistics of a bus computed once after the catalogue is filled
+		struct BusStat {
+			uint32_t stop_count = 0;
+			uint32_t unique_stop_count = 0;
+			int route_length = 0;// meters
+			double curvature = 0.0;
+		};
+
+		// Road distance set between stops, the reverse direction uses it too unless it's set separately
+		struct RoadDistance {
+			domain::StopId from = 0;
+			domain::StopId to = 0;
+			int distance = 0;// meters
+		};
+
+		// Buses passing a stop sorted by names, a part of the flat index of the catalogue
+		using StopBuses = ranges::Range<const domain::BusRoute* const*>;
+
 		struct StatForStop {
 
-			StatForStop(std::string_view name_stop, const std::set<std::string_view>* buses);
+			StatForStop(std::string_view name_stop, std::optional<StopBuses> buses);
 
 			std::string name_stop_;
-			const std::set<std::string_view>* buses_;
+			std::optional<StopBuses> buses_;// nullopt for unknown stops
 		};
 
+		// Names are stored once in an arena, stops and buses in contiguous arrays by ids and stops of all buses
+		// in one flat array. The arrays grow like vectors, so pointers to stops and buses stay valid
+		// until the next Add*, ids stay valid always
 		class TransportCatalogue {
 		public:
-			struct DistancesHasher {
-				std::hash<uintptr_t> hasher;
-				size_t operator()(const std::pair<const domain::Stop*, const domain::Stop*>& p) const;
-			};
+			TransportCatalogue() = default;
+			TransportCatalogue(const TransportCatalogue&) = delete;
+			TransportCatalogue& operator=(const TransportCatalogue&) = delete;
+			TransportCatalogue(TransportCatalogue&&) = default;
+			TransportCatalogue& operator=(TransportCatalogue&&) = default;
+
+			// Allocates the arrays at once when the sizes are known before filling
+			void Reserve(size_t stop_count, size_t bus_count, size_t route_stop_count);
 
-			void AddStop(std::string name_stop, geo::Coordinates coordinates);
+			void AddStop(std::string_view name_stop, geo::Coordinates coordinates);
 
-			void AddBusRoute(std::string name_bus, std::vector<std::string> stops, bool is_roundtrip = false);
+			void AddBusRoute(std::string_view name_bus, const std::vector<std::string>& stops, bool is_roundtrip = false);
 
+			// The first distance set between the stops is kept
 			void SetDistance(const domain::Stop* from, const domain::Stop* to, int distance);
 
-			//return value in meters
+			// Builds the adjacency arrays of distances, call after all distances are added.
+			// AddStop and SetDistance drop them
+			void BuildDistances();
+
+			//return value in meters, throws std::out_of_range if the distance isn't set
+			//and std::logic_error if the adjacency arrays aren't built
 			int GetDistance(const domain::Stop* from, const domain::Stop* to) const;
 
 			StatBusRoute RequestStatBusRoute(std::string_view name_bus) const;
 
 			StatForStop RequestStatForStop(std::string_view name_stop) const;
 
-			const domain::BusRoute* SearchRoute(std::string_view name_bus) const;
+			// Fills the table of bus statistics in parallel, call after all buses and distances are added.
+			// AddBusRoute and SetDistance drop the table, then statistics are computed on every request
+			void ComputeBusStats(size_t thread_count = 0);
 
-			const domain::Stop* SearchStop(std::string_view name_stop) const;
+			// Table computed earlier, e.g. loaded from the base, by ids of buses
+			void SetBusStats(std::vector<BusStat> bus_stats);
 
-			const std::deque<domain::BusRoute>& GetBusRoutes() const;
+			const std::vector<BusStat>& GetBusStats() const;
 
-			const std::deque<domain::Stop>& GetStops() const;
+			// Builds the index of buses of stops, call after all buses are added.
+			// AddStop and AddBusRoute drop the index
+			void BuildStopBuses();
 
-			const std::unordered_map<std::pair<const domain::Stop*, const domain::Stop*>, int, DistancesHasher>& GetDistances() const;
+			// Index built earlier, e.g. loaded from the base: buses of stop s are ids
+			// [offsets[s], offsets[s + 1]) of bus_ids sorted by names
+			void SetStopBuses(std::vector<uint32_t> offsets, const std::vector<domain::BusId>& bus_ids);
 
-			const std::unordered_map<std::string_view, size_t>& GetIndexedOfStops() const;
+			const domain::BusRoute* SearchRoute(std::string_view name_bus) const;
 
-			const std::unordered_map<std::string_view, size_t>& GetIndexesOfBusRoutes() const;
-		private:
+			const domain::Stop* SearchStop(std::string_view name_stop) const;
 
-			std::deque<domain::Stop> stops_;
-			std::deque<domain::BusRoute> bus_routes_;
-			std::unordered_map<std::string_view, domain::Stop*> index_stops_;
-			std::unordered_map<std::string_view, domain::BusRoute*> index_buses_;
-			std::unordered_map<std::pair<const domain::Stop*, const domain::Stop*>, int, DistancesHasher> distances_;
-			std::unordered_map<std::string_view, std::set<std::string_view>> stop_buses_;
+			const std::vector<domain::BusRoute>& GetBusRoutes() const;
 
-			//integer indexes for serialization
-			mutable std::unique_ptr<std::unordered_map<std::string_view, size_t>> indexes_of_stops;
-			mutable std::unique_ptr<std::unordered_map<std::string_view, size_t>> indexes_of_bus_routes;
+			const std::vector<domain::Stop>& GetStops() const;
+
+			// distances in the order they were set
+			const std::vector<RoadDistance>& GetDistances() const;
+
+			// Buses passing the stop sorted by names, throws std::logic_error if the index isn't built
+			StopBuses GetStopBuses(domain::StopId id) const;
+		private:
+			// The same name of a stop and a bus is stored once
+			std::string_view InternName(std::string_view name);
+
+			BusStat ComputeBusStat(const domain::BusRoute& bus_route) const;
+
+			// Move the arrays to new storage and fix pointers to their elements
+			void ReserveStops(size_t count);
+			void ReserveRouteStops(size_t count);
+
+			memory::StringArena names_;
+			std::vector<domain::Stop> stops_;// by ids
+			std::vector<domain::BusRoute> bus_routes_;// by ids
+			std::vector<const domain::Stop*> route_stops_;// stops of all buses one after another
+			std::unordered_map<std::string_view, domain::StopId> index_stops_;
+			std::unordered_map<std::string_view, domain::BusId> index_buses_;
+			std::vector<RoadDistance> distances_;
+			// neighbours of stop s with distances to them take [distance_offsets_[s], distance_offsets_[s + 1])
+			// of neighbour_distances_ sorted by ids, reverse directions are included
+			std::vector<uint32_t> distance_offsets_;
+			std::vector<std::pair<domain::StopId, int>> neighbour_distances_;
+			// buses of stop s take [stop_bus_offsets_[s], stop_bus_offsets_[s + 1]) of stop_buses_
+			std::vector<uint32_t> stop_bus_offsets_;
+			std::vector<const domain::BusRoute*> stop_buses_;
+			std::vector<BusStat> bus_stats_;// by ids of buses, empty until computed
 		};
 
 	}//end namespace transport_catalogue
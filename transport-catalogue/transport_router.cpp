@@ -1,123 +1,632 @@
 #include "transport_router.h"
+#include "raptor.h"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
 
 namespace transport_directory {
 
 	namespace transport_router {
 
+		Weight MinutesToWeight(double minutes) {
+			if constexpr (std::is_integral_v<Weight>) {
+				using namespace std::literals;
+				const double units = std::round(minutes * WEIGHT_UNITS_PER_MINUTE);
+				if (!(units < static_cast<double>(std::numeric_limits<Weight>::max()))) {
+					throw std::out_of_range("Time of "s + std::to_string(minutes) + " minutes doesn't fit the weight"s);
+				}
+				return static_cast<Weight>(units);
+			}
+			else {
+				return minutes;
+			}
+		}
+
+		double WeightToMinutes(Weight weight) {
+			return weight / WEIGHT_UNITS_PER_MINUTE;
+		}
+
 		//-----------------------------class TransportRouter -------------------------------------------------
 
 		TransportRouter::TransportRouter(const transport_catalogue::TransportCatalogue& guide, RoutingSettings routing_settings)
 			:guide_(guide),
 			routing_settings_(routing_settings)
 		{
-			ConstructGraphAndFillGraphByStops();
-			FillGraphByBusRoutes();
-			router_ = std::make_unique<graph::Router<Weight>>(*graph_);
+			FindClosedStops();
+			BuildGraph();
+			CreateRouter();
+			raptor_ = std::make_unique<Raptor>(guide_, routing_settings_);
 		}
 
-		TransportRouter::TransportRouter(const transport_catalogue::TransportCatalogue& guide, RoutingSettings routing_settings, const DownloadedData& data_for_router)
+		TransportRouter::TransportRouter(const transport_catalogue::TransportCatalogue& guide, RoutingSettings routing_settings, DownloadedData&& data_for_router)
 			: guide_(guide)
 			, routing_settings_(std::move(routing_settings))
-			, stop_id_(data_for_router.stop_id)
-			, edge_id_data_(data_for_router.edge_id_data)
-			, graph_(std::make_unique<Graph>(*data_for_router.graph))
-			, router_(std::make_unique<graph::Router<Weight>>(*graph_, data_for_router.data_of_router))
-		{}
+			, stop_wait_edges_(std::move(data_for_router.stop_wait_edges))
+			, edge_data_(std::move(data_for_router.edge_data))
+			, graph_(std::move(data_for_router.graph))
+		{
+			graph_->Freeze();
+			if (routing_settings_.router_type != RouterType::RAPTOR) {
+				IndexStopVertices();
+			}
+			switch (routing_settings_.router_type) {
+			case RouterType::ALL_PAIRS:
+				router_ = std::make_unique<graph::Router<Weight>>(*graph_, std::move(data_for_router.data_of_router));
+				break;
+			case RouterType::CONTRACTION_HIERARCHY:
+				router_ = std::make_unique<graph::ContractionHierarchy<Weight>>(*graph_, std::move(data_for_router.hierarchy));
+				break;
+			case RouterType::HUB_LABELS:
+				router_ = std::make_unique<graph::HubLabels<Weight>>(*graph_, std::move(data_for_router.hierarchy),
+					std::move(data_for_router.hub_labels));
+				break;
+			case RouterType::CUSTOMIZABLE_CONTRACTION_HIERARCHY:
+				router_ = std::make_unique<graph::CustomizableContractionHierarchy<Weight>>(*graph_, std::move(data_for_router.ranks),
+					routing_settings_.thread_count);
+				break;
+			default:
+				CreateRouter();
+				break;
+			}
+			raptor_ = std::make_unique<Raptor>(guide_, routing_settings_);
+		}
+
+		TransportRouter::TransportRouter(const transport_catalogue::TransportCatalogue& guide, RoutingSettings routing_settings, const TransportRouter& previous)
+			:guide_(guide),
+			routing_settings_(routing_settings)
+		{
+			FindClosedStops();
+			BuildGraph();
+			raptor_ = std::make_unique<Raptor>(guide_, routing_settings_);
+			if (routing_settings_.router_type == RouterType::CUSTOMIZABLE_CONTRACTION_HIERARCHY
+				&& previous.routing_settings_.router_type == RouterType::CUSTOMIZABLE_CONTRACTION_HIERARCHY && HasSameStructure(previous)) {
+				const auto& previous_router = static_cast<const graph::CustomizableContractionHierarchy<Weight>&>(*previous.router_);
+				router_ = std::make_unique<graph::CustomizableContractionHierarchy<Weight>>(*graph_, previous_router.GetRanks(),
+					routing_settings_.thread_count);
+				return;
+			}
+			if (routing_settings_.router_type != RouterType::ALL_PAIRS || previous.routing_settings_.router_type != RouterType::ALL_PAIRS) {
+				CreateRouter();
+				return;
+			}
+			std::vector<VertexId> vertex_map;
+			std::vector<EdgeId> edge_map;
+			MapPreviousGraph(previous, vertex_map, edge_map);
+			router_ = std::make_unique<graph::Router<Weight>>(*graph_, GetStopVertices(), *previous.graph_,
+				static_cast<const graph::Router<Weight>&>(*previous.router_).GetData(), vertex_map, edge_map, routing_settings_.thread_count);
+		}
+
+		TransportRouter::~TransportRouter() = default;
 
 		std::optional<TransportRouter::RouteInfo> TransportRouter::BuildRoute(std::string_view from, std::string_view to) const {
-			const domain::Stop* start = guide_.SearchStop(from);
-			const domain::Stop* finish = guide_.SearchStop(to);
+			return BuildRoute(guide_.SearchStop(from), guide_.SearchStop(to));
+		}
+
+		std::optional<TransportRouter::RouteInfo> TransportRouter::BuildRoute(const domain::Stop* start, const domain::Stop* finish) const {
 			if (!start || !finish) {
 				return std::nullopt;
 			}
-			auto it_start = stop_id_.find(start);
-			auto it_finish = stop_id_.find(finish);
-			if (it_start == stop_id_.end() || it_finish == stop_id_.end()) {
+			if (!router_) {
+				return raptor_->BuildRoute(start, finish);
+			}
+			const auto from_id = GetStopVertex(start);
+			const auto to_id = GetStopVertex(finish);
+			if (!from_id || !to_id) {
 				return std::nullopt;
 			}
-			VertexId from_id = graph_->GetEdge(it_start->second).from;
-			VertexId to_id = graph_->GetEdge(it_finish->second).from;
-			auto route_info = router_->BuildRoute(from_id, to_id);
+			auto route_info = router_->BuildRoute(*from_id, *to_id);
 			if (!route_info) {
 				return std::nullopt;
 			}
 			RouteInfo result;
 			result.weight = route_info->weight;
+			if (routing_settings_.graph_model == GraphModel::STOP_VERTICES) {
+				// every bus edge begins with the wait folded into it; the total is summed in the order of items,
+				// as the search over the wait edges of GraphModel::STOP_PAIRS sums it
+				const Weight wait_weight = MinutesToWeight(static_cast<double>(routing_settings_.bus_wait_time));
+				result.weight = Weight{};
+				for (const EdgeId id : route_info->edges) {
+					result.edges.push_back(DataEdge{ wait_weight, vertex_stops_[graph_->GetEdge(id).from], 0 });
+					result.edges.push_back(edge_data_[id]);
+					result.weight += result.edges[result.edges.size() - 2].weight;
+					result.weight += result.edges.back().weight;
+				}
+				return result;
+			}
+			if (routing_settings_.graph_model == GraphModel::STOP_PAIRS) {
+				for (const EdgeId id : route_info->edges) {
+					result.edges.push_back(edge_data_[id]);
+				}
+				return result;
+			}
+			// edges of one trip in GraphModel::RIDE_VERTICES go in a row and make up one item: boarding, rides
+			// and alighting; the weight of the item and the total are summed as GraphModel::STOP_PAIRS sums them
+			result.weight = Weight{};
+			size_t board = 0;// position of boarding in the route of the bus of the last item
+			Weight transfer_weight{};
+			auto finish_trip = [&]() {
+				DataEdge& trip = result.edges.back();
+				if (std::holds_alternative<const domain::BusRoute*>(trip.obj)) {
+					const auto& bus_route = *std::get<const domain::BusRoute*>(trip.obj);
+					trip.weight = graph::AddWeights(transfer_weight, ComputeRideWeight(bus_route, board, board + trip.spun_count + 1));
+				}
+				result.weight += trip.weight;
+			};
 			for (const EdgeId id : route_info->edges) {
-				result.edges.push_back(edge_id_data_.at(id));
+				const DataEdge& data_edge = edge_data_[id];
+				const bool is_bus = std::holds_alternative<const domain::BusRoute*>(data_edge.obj);
+				if (!result.edges.empty() && is_bus && result.edges.back().obj == data_edge.obj) {
+					if (data_edge.spun_count != 1) {
+						transfer_weight = graph::AddWeights(transfer_weight, data_edge.weight);
+					}
+					result.edges.back().spun_count += data_edge.spun_count;
+					continue;
+				}
+				if (!result.edges.empty()) {
+					finish_trip();
+				}
+				if (is_bus) {
+					// a trip begins with boarding at its ride vertex
+					board = graph_->GetEdge(id).to - first_ride_vertices_[std::get<const domain::BusRoute*>(data_edge.obj)->id];
+					transfer_weight = data_edge.weight;
+				}
+				result.edges.push_back(data_edge);
+			}
+			if (!result.edges.empty()) {
+				finish_trip();
 			}
 			return result;
 		}
 
-		TransportRouter::DownloadedData TransportRouter::GetDataForTransRouter() const {
+		std::optional<TransportRouter::RouteInfo> TransportRouter::BuildRoute(std::string_view from, std::string_view to, const RoutingProfile& profile) const {
+			return BuildRoute(guide_.SearchStop(from), guide_.SearchStop(to), profile);
+		}
+
+		std::optional<TransportRouter::RouteInfo> TransportRouter::BuildRoute(const domain::Stop* start, const domain::Stop* finish, const RoutingProfile& profile) const {
+			return raptor_->BuildRoute(start, finish, profile);
+		}
+
+		std::vector<std::vector<std::optional<Weight>>> TransportRouter::ComputeRouteMatrix(const std::vector<const domain::Stop*>& from,
+			const std::vector<const domain::Stop*>& to) const {
+			// unknown destinations are left out of the searches and stay nullopt in every row
+			std::vector<VertexId> targets;
+			std::vector<size_t> target_columns;
+			for (size_t column = 0; column < to.size(); ++column) {
+				if (const auto vertex = GetStopVertex(to[column])) {
+					targets.push_back(*vertex);
+					target_columns.push_back(column);
+				}
+			}
+
+			std::vector<std::vector<std::optional<Weight>>> matrix(from.size(), std::vector<std::optional<Weight>>(to.size()));
+			std::lock_guard lock(thread_pool_mutex_);
+			parallel::ThreadPool& pool = GetThreadPool();
+			if (!router_) {
+				pool.ParallelFor(from.size(), [&](size_t row) {
+					matrix[row] = raptor_->ComputeRouteWeights(from[row], to);
+				});
+				return matrix;
+			}
+			pool.ParallelFor(from.size(), [&](size_t row) {
+				const auto source = GetStopVertex(from[row]);
+				if (!source || targets.empty()) {
+					return;
+				}
+				auto weights = router_->ComputeRouteWeights(*source, targets);
+				for (size_t i = 0; i < weights.size(); ++i) {
+					matrix[row][target_columns[i]] = weights[i];
+				}
+			});
+			return matrix;
+		}
+
+		TransportRouter::DownloadedData TransportRouter::ReleaseDataForTransRouter() {
 			DownloadedData data;
-			data.graph = std::make_unique<Graph>(*graph_);
-			data.edge_id_data = edge_id_data_;
-			data.stop_id = stop_id_;
-			data.data_of_router = router_->GetData();
+			switch (routing_settings_.router_type) {
+			case RouterType::ALL_PAIRS:
+				data.data_of_router = static_cast<graph::Router<Weight>&>(*router_).ReleaseData();
+				break;
+			case RouterType::CONTRACTION_HIERARCHY:
+				data.hierarchy = static_cast<graph::ContractionHierarchy<Weight>&>(*router_).ReleaseData();
+				break;
+			case RouterType::HUB_LABELS:
+			{
+				auto& hub_labels = static_cast<graph::HubLabels<Weight>&>(*router_);
+				data.hierarchy = hub_labels.ReleaseHierarchyData();
+				data.hub_labels = hub_labels.ReleaseData();
+				break;
+			}
+			case RouterType::CUSTOMIZABLE_CONTRACTION_HIERARCHY:
+				data.ranks = static_cast<const graph::CustomizableContractionHierarchy<Weight>&>(*router_).GetRanks();
+				break;
+			default:
+				break;
+			}
+			// the engine refers to the graph, so it goes first
+			router_.reset();
+			data.graph = std::move(graph_);
+			data.edge_data = std::move(edge_data_);
+			data.stop_wait_edges = std::move(stop_wait_edges_);
 			return data;
 		}
 
-		const std::unordered_map<const domain::Stop*, EdgeId>& TransportRouter::GetStopId() const {
-			return stop_id_;
+		const std::vector<EdgeId>& TransportRouter::GetStopWaitEdges() const {
+			return stop_wait_edges_;
 		}
 
-		const std::unordered_map<EdgeId, TransportRouter::DataEdge>& TransportRouter::GetEdgeIdData() const {
-			return edge_id_data_;
+		const std::vector<TransportRouter::DataEdge>& TransportRouter::GetEdgeData() const {
+			return edge_data_;
+		}
+
+		size_t TransportRouter::GetPrunedEdgeCount() const {
+			return pruned_edge_count_;
 		}
 
 		const Graph& TransportRouter::GetGraph() const {
 			return *graph_;
 		}
 
-		const graph::Router<Weight>& TransportRouter::GetRouter() const {
+		const graph::RouterEngine<Weight>& TransportRouter::GetRouter() const {
 			return *router_;
 		}
 
-		void TransportRouter::ConstructGraphAndFillGraphByStops() {
+		void TransportRouter::CreateRouter() {
+			switch (routing_settings_.router_type) {
+			case RouterType::ALL_PAIRS:
+				router_ = std::make_unique<graph::Router<Weight>>(*graph_, GetStopVertices(), routing_settings_.thread_count);
+				break;
+			case RouterType::ON_DEMAND:
+				router_ = std::make_unique<graph::DijkstraRouter<Weight>>(*graph_, routing_settings_.bidirectional_search);
+				break;
+			case RouterType::CONTRACTION_HIERARCHY:
+				router_ = std::make_unique<graph::ContractionHierarchy<Weight>>(*graph_);
+				break;
+			case RouterType::HUB_LABELS:
+				router_ = std::make_unique<graph::HubLabels<Weight>>(*graph_, routing_settings_.thread_count);
+				break;
+			case RouterType::CUSTOMIZABLE_CONTRACTION_HIERARCHY:
+				router_ = std::make_unique<graph::CustomizableContractionHierarchy<Weight>>(*graph_, routing_settings_.thread_count);
+				break;
+			case RouterType::RAPTOR:
+				break;
+			}
+		}
+
+		parallel::ThreadPool& TransportRouter::GetThreadPool() const {
+			if (!thread_pool_) {
+				thread_pool_ = std::make_unique<parallel::ThreadPool>(routing_settings_.thread_count);
+			}
+			return *thread_pool_;
+		}
+
+		void TransportRouter::FindClosedStops() {
+			is_closed_.assign(guide_.GetStops().size(), 0);
+			for (const std::string& name : routing_settings_.closed_stops) {
+				if (const domain::Stop* stop = guide_.SearchStop(name)) {
+					is_closed_[stop->id] = 1;
+				}
+			}
+		}
+
+		bool TransportRouter::KeepsClosedEdges() const {
+			return routing_settings_.router_type == RouterType::CUSTOMIZABLE_CONTRACTION_HIERARCHY;
+		}
+
+		bool TransportRouter::HasSameStructure(const TransportRouter& previous) const {
+			const Graph& previous_graph = *previous.graph_;
+			if (graph_->GetVertexCount() != previous_graph.GetVertexCount() || graph_->GetEdgeCount() != previous_graph.GetEdgeCount()) {
+				return false;
+			}
+			for (EdgeId id = 0; id < graph_->GetEdgeCount(); ++id) {
+				const Edge& edge = graph_->GetEdge(id);
+				const Edge& previous_edge = previous_graph.GetEdge(id);
+				if (edge.from != previous_edge.from || edge.to != previous_edge.to) {
+					return false;
+				}
+			}
+			return true;
+		}
+
+		void TransportRouter::BuildGraph() {
+			if (routing_settings_.router_type == RouterType::RAPTOR) {
+				graph_ = std::make_unique<Graph>();
+				graph_->Freeze();
+				return;
+			}
+			ConstructGraphAndFillGraphByStops();
+			FillGraphByBusRoutes();
+			graph_->Freeze();
+		}
+
+		std::optional<VertexId> TransportRouter::GetStopVertex(const domain::Stop* stop) const {
+			if (!stop || stop->id >= stop_vertices_.size() || stop_vertices_[stop->id] == NO_STOP_VERTEX) {
+				return std::nullopt;
+			}
+			return stop_vertices_[stop->id];
+		}
+
+		std::vector<VertexId> TransportRouter::GetStopVertices() const {
+			std::vector<VertexId> vertices;
+			for (const VertexId vertex : stop_vertices_) {
+				if (vertex != NO_STOP_VERTEX) {
+					vertices.push_back(vertex);
+				}
+			}
+			return vertices;
+		}
+
+		void TransportRouter::IndexStopVertices() {
 			const auto& stops = guide_.GetStops();
+			const VertexId vertices_per_stop = routing_settings_.graph_model == GraphModel::STOP_VERTICES ? 1 : 2;
+			stop_vertices_.assign(stops.size(), NO_STOP_VERTEX);
+			vertex_stops_.clear();
 			for (const auto& stop : stops) {
-				auto stat = guide_.RequestStatForStop(stop.name);
-				if (!stat.buses_ || stat.buses_->empty()) {
+				if (!guide_.GetStopBuses(stop.id).empty()) {
+					stop_vertices_[stop.id] = vertex_stops_.size() * vertices_per_stop;
+					vertex_stops_.push_back(&stop);
+				}
+			}
+			first_ride_vertices_.clear();
+			if (routing_settings_.graph_model == GraphModel::RIDE_VERTICES) {
+				const auto& bus_routes = guide_.GetBusRoutes();
+				first_ride_vertices_.reserve(bus_routes.size());
+				VertexId ride_vertex = vertex_stops_.size() * 2;
+				for (const auto& bus_route : bus_routes) {
+					first_ride_vertices_.push_back(ride_vertex);
+					ride_vertex += bus_route.route.size();
+				}
+			}
+		}
+
+		Weight TransportRouter::ComputeRideWeight(const domain::BusRoute& bus_route, size_t board, size_t alight) const {
+			int64_t length = 0;
+			for (size_t i = board; i < alight; ++i) {
+				length += guide_.GetDistance(bus_route.route[i], bus_route.route[i + 1]);
+			}
+			return ComputeWeightForDistance(length, routing_settings_.bus_velocity);
+		}
+
+		std::unordered_map<std::string_view, std::vector<EdgeId>> TransportRouter::GetBusEdgeIds() const {
+			std::unordered_map<std::string_view, std::vector<EdgeId>> bus_edge_ids;
+			for (EdgeId id = 0; id < graph_->GetEdgeCount(); ++id) {
+				const auto& obj = edge_data_[id].obj;
+				if (std::holds_alternative<const domain::BusRoute*>(obj)) {
+					bus_edge_ids[std::get<const domain::BusRoute*>(obj)->name].push_back(id);
+				}
+			}
+			return bus_edge_ids;
+		}
+
+		void TransportRouter::MapPreviousGraph(const TransportRouter& previous, std::vector<VertexId>& vertex_map, std::vector<EdgeId>& edge_map) const {
+			using PreviousRouter = graph::Router<Weight>;
+			const Graph& previous_graph = *previous.graph_;
+			vertex_map.assign(previous_graph.GetVertexCount(), PreviousRouter::NO_VERTEX);
+			edge_map.assign(previous_graph.GetEdgeCount(), PreviousRouter::NO_EDGE);
+
+			// ids of the previous catalogue may differ, so stops are matched by names
+			size_t previous_stop_vertex_count = 0;
+			const auto& previous_stops = previous.guide_.GetStops();
+			for (domain::StopId previous_stop = 0; previous_stop < previous.stop_vertices_.size(); ++previous_stop) {
+				if (previous.stop_vertices_[previous_stop] == NO_STOP_VERTEX) {
+					continue;
+				}
+				const EdgeId previous_id = previous.stop_wait_edges_[previous_stop];
+				previous_stop_vertex_count += previous_id == NO_WAIT_EDGE ? 1 : 2;
+				const domain::Stop* stop = guide_.SearchStop(previous_stops[previous_stop].name);
+				if (!stop || stop_vertices_[stop->id] == NO_STOP_VERTEX) {
+					continue;
+				}
+				vertex_map[previous.stop_vertices_[previous_stop]] = stop_vertices_[stop->id];
+				const EdgeId id = stop_wait_edges_[stop->id];
+				if (previous_id == NO_WAIT_EDGE || id == NO_WAIT_EDGE) {
+					continue;// the wait of GraphModel::STOP_VERTICES is a part of bus edges
+				}
+				const Edge& previous_edge = previous_graph.GetEdge(previous_id);
+				const Edge& edge = graph_->GetEdge(id);
+				vertex_map[previous_edge.from] = edge.from;
+				vertex_map[previous_edge.to] = edge.to;
+				if (previous_edge.weight == edge.weight) {
+					edge_map[previous_id] = id;
+				}
+			}
+
+			// a bus is kept if its edges go between the same vertices with the same weights;
+			// its own vertices of GraphModel::RIDE_VERTICES are matched along with the edges
+			const auto bus_edge_ids = GetBusEdgeIds();
+			for (const auto& [name, previous_ids] : previous.GetBusEdgeIds()) {
+				auto it = bus_edge_ids.find(name);
+				if (it == bus_edge_ids.end() || it->second.size() != previous_ids.size()) {
 					continue;
 				}
-				stop_id_[&stop];
+				const std::vector<EdgeId>& ids = it->second;
+				std::unordered_map<VertexId, VertexId> ride_vertex_map;
+				auto match_vertex = [&](VertexId previous_vertex, VertexId vertex) {
+					if (vertex_map[previous_vertex] != PreviousRouter::NO_VERTEX) {
+						return vertex_map[previous_vertex] == vertex;
+					}
+					if (previous_vertex < previous_stop_vertex_count) {
+						return false;// the stop is removed
+					}
+					return ride_vertex_map.emplace(previous_vertex, vertex).first->second == vertex;
+				};
+				bool is_same = true;
+				for (size_t i = 0; i < ids.size() && is_same; ++i) {
+					const Edge& previous_edge = previous_graph.GetEdge(previous_ids[i]);
+					const Edge& edge = graph_->GetEdge(ids[i]);
+					is_same = previous_edge.weight == edge.weight
+						&& match_vertex(previous_edge.from, edge.from) && match_vertex(previous_edge.to, edge.to);
+				}
+				if (!is_same) {
+					continue;
+				}
+				for (const auto& [previous_vertex, vertex] : ride_vertex_map) {
+					vertex_map[previous_vertex] = vertex;
+				}
+				for (size_t i = 0; i < ids.size(); ++i) {
+					edge_map[previous_ids[i]] = ids[i];
+				}
+			}
+		}
+
+		void TransportRouter::ConstructGraphAndFillGraphByStops() {
+			IndexStopVertices();
+			const bool folds_wait = routing_settings_.graph_model == GraphModel::STOP_VERTICES;
+			size_t vertex_count = folds_wait ? vertex_stops_.size() : vertex_stops_.size() * 2;
+			if (routing_settings_.graph_model == GraphModel::RIDE_VERTICES) {
+				for (const auto& bus_route : guide_.GetBusRoutes()) {
+					vertex_count += bus_route.route.size();
+				}
 			}
-			graph_ = std::make_unique<Graph>(stop_id_.size() * 2);
-			size_t count = 0;
-			for (auto& [stop, id] : stop_id_) {
-				VertexId from = count++;
-				VertexId to = count++;
-				id = graph_->AddEdge(Edge{ from, to, static_cast<double>(routing_settings_.bus_wait_time) });
-				edge_id_data_.emplace(id, DataEdge{ static_cast<double>(routing_settings_.bus_wait_time), stop, 0 });
+			graph_ = std::make_unique<Graph>(vertex_count);
+			stop_wait_edges_.assign(guide_.GetStops().size(), NO_WAIT_EDGE);
+			if (folds_wait) {
+				return;
+			}
+			const Weight wait_weight = MinutesToWeight(static_cast<double>(routing_settings_.bus_wait_time));
+			for (const domain::Stop* stop : vertex_stops_) {
+				VertexId from = stop_vertices_[stop->id];
+				VertexId to = from + 1;
+				EdgeId id = graph_->AddEdge(Edge{ from, to, wait_weight });
+				stop_wait_edges_[stop->id] = id;
+				edge_data_.push_back(DataEdge{ wait_weight, stop, 0 });
 			}
 		}
 
 		void TransportRouter::FillGraphByBusRoutes() {
 			const auto& bus_routes = guide_.GetBusRoutes();
-			for (const auto& bus_route : bus_routes) {
-				AddBusRouteToGraph(bus_route);
+
+			// edges of buses are collected in parallel and added to the graph in the order of buses,
+			// so edge ids don't depend on the number of threads
+			std::lock_guard lock(thread_pool_mutex_);
+			parallel::ThreadPool& pool = GetThreadPool();
+			auto add_edges = [this](const BusEdges& bus_edges) {
+				for (size_t i = 0; i < bus_edges.edges.size(); ++i) {
+					graph_->AddEdge(bus_edges.edges[i]);
+					edge_data_.push_back(bus_edges.data[i]);
+				}
+			};
+			// only edges between stops can be parallel; RouterType::CUSTOMIZABLE_CONTRACTION_HIERARCHY keeps them,
+			// so the graph structure doesn't depend on weights
+			const bool has_rides = routing_settings_.graph_model == GraphModel::RIDE_VERTICES;
+			const bool prunes_edges = !has_rides && !KeepsClosedEdges();
+			BusEdges collected_edges;
+			std::vector<BusEdges> batch;
+			for (size_t batch_begin = 0; batch_begin < bus_routes.size(); batch_begin += BUS_BATCH_SIZE) {
+				const size_t batch_end = std::min(bus_routes.size(), batch_begin + BUS_BATCH_SIZE);
+				batch.assign(batch_end - batch_begin, BusEdges{});
+				pool.ParallelFor(batch.size(), [&](size_t index) {
+					const size_t bus_index = batch_begin + index;
+					if (!has_rides) {
+						CollectBusRouteEdges(bus_routes[bus_index], batch[index]);
+					}
+					else {
+						CollectBusRideEdges(bus_routes[bus_index], first_ride_vertices_[bus_index], batch[index]);
+					}
+				});
+				for (const BusEdges& bus_edges : batch) {
+					if (!prunes_edges) {
+						add_edges(bus_edges);
+						continue;
+					}
+					collected_edges.edges.insert(collected_edges.edges.end(), bus_edges.edges.begin(), bus_edges.edges.end());
+					collected_edges.data.insert(collected_edges.data.end(), bus_edges.data.begin(), bus_edges.data.end());
+				}
+			}
+			if (prunes_edges) {
+				pruned_edge_count_ = PruneDominatedEdges(collected_edges);
+				add_edges(collected_edges);
+			}
+		}
+
+		size_t TransportRouter::PruneDominatedEdges(BusEdges& bus_edges) const {
+			auto& edges = bus_edges.edges;
+			auto& data = bus_edges.data;
+			const uint64_t vertex_count = graph_->GetVertexCount();
+			std::unordered_map<uint64_t, size_t> kept_indexes;// by pairs of vertices
+			kept_indexes.reserve(edges.size());
+			size_t kept_count = 0;
+			for (size_t i = 0; i < edges.size(); ++i) {
+				const auto [it, is_first] = kept_indexes.emplace(edges[i].from * vertex_count + edges[i].to, kept_count);
+				if (is_first) {
+					edges[kept_count] = edges[i];
+					data[kept_count] = data[i];
+					++kept_count;
+					continue;
+				}
+				// of equal edges the first one is kept, as a search relaxing all of them would take it
+				const size_t kept = it->second;
+				if (edges[i].weight < edges[kept].weight
+					|| (edges[i].weight == edges[kept].weight && data[i].spun_count < data[kept].spun_count)) {
+					edges[kept] = edges[i];
+					data[kept] = data[i];
+				}
+			}
+			const size_t pruned_count = edges.size() - kept_count;
+			edges.resize(kept_count);
+			data.resize(kept_count);
+			return pruned_count;
+		}
+
+		std::vector<int64_t> TransportRouter::ComputeRouteDistances(const transport_catalogue::TransportCatalogue& guide,
+			domain::RouteStops route) {
+			std::vector<int64_t> distances(route.size(), 0);//meters from the first stop
+			for (size_t i = 1; i < route.size(); ++i) {
+				distances[i] = distances[i - 1] + guide.GetDistance(route[i - 1], route[i]);
 			}
+			return distances;
 		}
 
-		Weight TransportRouter::ComputeWeightForRoute(ranges::Range<std::vector<const domain::Stop*>::const_iterator> route) const {
-			int64_t length = 0;//meters
-			for (auto it = std::next(route.begin()); it != route.end(); ++it) {
-				length += guide_.GetDistance(*std::prev(it), *it);
+		Weight TransportRouter::ComputeWeightForDistance(int64_t length, double bus_velocity) {
+			return MinutesToWeight(static_cast<double>(length * 60) / (bus_velocity * 1000));
+		}
+
+		void TransportRouter::CollectBusRouteEdges(const domain::BusRoute& bus_route, BusEdges& bus_edges) const {
+			const auto& route = bus_route.route;
+			const std::vector<int64_t> distances = ComputeRouteDistances(guide_, route);
+			const bool folds_wait = routing_settings_.graph_model == GraphModel::STOP_VERTICES;
+			const Weight wait_weight = MinutesToWeight(static_cast<double>(routing_settings_.bus_wait_time));
+			for (size_t i = 0; i + 1 < route.size(); ++i) {
+				// starting from the end of waiting, or from the stop if the wait is a part of the edge
+				VertexId from = folds_wait ? stop_vertices_[route[i]->id] : graph_->GetEdge(stop_wait_edges_[route[i]->id]).to;
+				for (size_t j = i + 1; j < route.size(); ++j) {
+					VertexId to = stop_vertices_[route[j]->id]; // the end of the movement is at the beginning of the waiting
+					const bool is_closed = is_closed_[route[i]->id] || is_closed_[route[j]->id];
+					if (is_closed && !KeepsClosedEdges()) {
+						continue;
+					}
+					Weight weight = is_closed ? CLOSED_EDGE_WEIGHT
+						: ComputeWeightForDistance(distances[j] - distances[i], routing_settings_.bus_velocity);
+					bus_edges.edges.push_back(Edge{ from, to, folds_wait ? graph::AddWeights(wait_weight, weight) : weight });
+					bus_edges.data.push_back(DataEdge{ weight, &bus_route, static_cast<int>(j - i) - 1 });
+				}
 			}
-			return static_cast<double>(length * 60) / (routing_settings_.bus_velocity * 1000);
 		}
 
-		void TransportRouter::AddBusRouteToGraph(const domain::BusRoute& bus_route) {
-			for (auto it = bus_route.route.begin();
-				it != bus_route.route.end() && it != std::prev(bus_route.route.end());
-				++it) {
-				for (auto it2 = std::next(it); it2 != bus_route.route.end(); ++it2) {
-					VertexId from = graph_->GetEdge(stop_id_[*it]).to; // starting from the end of waiting
-					VertexId to = graph_->GetEdge(stop_id_[*it2]).from; // the end of the movement is at the beginning of the waiting
-					Weight weight = ComputeWeightForRoute(ranges::Range(it, std::next(it2)));
-					EdgeId id = graph_->AddEdge(Edge{ from, to, weight });
-					edge_id_data_.emplace(id, DataEdge{weight, &bus_route, static_cast<int>(std::distance(it, it2)) - 1});
+		void TransportRouter::CollectBusRideEdges(const domain::BusRoute& bus_route, VertexId first_vertex, BusEdges& bus_edges) const {
+			const auto& route = bus_route.route;
+			const std::vector<int64_t> distances = ComputeRouteDistances(guide_, route);
+			for (size_t i = 0; i < route.size(); ++i) {
+				const VertexId ride_vertex = first_vertex + i;
+				const Edge& wait_edge = graph_->GetEdge(stop_wait_edges_[route[i]->id]);
+				const bool is_closed = is_closed_[route[i]->id] != 0;
+				const Weight transfer_weight = is_closed ? CLOSED_EDGE_WEIGHT : 0;
+				if (i + 1 < route.size()) {
+					// boarding from the end of waiting; -1 makes a whole trip report span_count as a direct edge of STOP_PAIRS does
+					if (!is_closed || KeepsClosedEdges()) {
+						bus_edges.edges.push_back(Edge{ wait_edge.to, ride_vertex, transfer_weight });
+						bus_edges.data.push_back(DataEdge{ transfer_weight, &bus_route, -1 });
+					}
+					Weight weight = ComputeWeightForDistance(distances[i + 1] - distances[i], routing_settings_.bus_velocity);
+					bus_edges.edges.push_back(Edge{ ride_vertex, ride_vertex + 1, weight });
+					bus_edges.data.push_back(DataEdge{ weight, &bus_route, 1 });
+				}
+				if (i > 0 && (!is_closed || KeepsClosedEdges())) {
+					// alighting to the beginning of waiting
+					bus_edges.edges.push_back(Edge{ ride_vertex, wait_edge.from, transfer_weight });
+					bus_edges.data.push_back(DataEdge{ transfer_weight, &bus_route, 0 });
 				}
 			}
 		}
@@ -2,30 +2,76 @@
 #include "transport_catalogue.h"
 #include "graph.h"
 #include "router.h"
+#include "dijkstra_router.h"
+#include "contraction_hierarchy.h"
+#include "customizable_contraction_hierarchy.h"
+#include "hub_labels.h"
 #include "domain.h"
 #include "ranges.h"
+#include "thread_pool.h"
 
+#include <cstdint>
+#include <limits>
+#include <string>
 #include <unordered_map>
 #include <string_view>
 #include <variant>
 #include <memory>
+#include <mutex>
+#include <vector>
 
 namespace transport_directory {
 
 	namespace transport_router {
 
+#ifdef TRANSPORT_ROUTER_INTEGRAL_WEIGHT
+		// Time in tenths of a millisecond: comparisons are exact and cells of the all-pairs table are half as large.
+		// Items of a route are rounded to 1/600000 of a minute, routes up to about 119 hours fit
+		using Weight = uint32_t;
+		inline constexpr double WEIGHT_UNITS_PER_MINUTE = 600000.0;
+#else
+		// Time in minutes
 		using Weight = double;
+		inline constexpr double WEIGHT_UNITS_PER_MINUTE = 1.0;
+#endif
 		using Graph = graph::DirectedWeightedGraph<Weight>;
 		using VertexId = graph::VertexId;
 		using EdgeId = graph::EdgeId;
 		using Edge = graph::Edge<Weight>;
 
+		// Weights are converted to minutes only when answers are printed
+		Weight MinutesToWeight(double minutes);
+		double WeightToMinutes(Weight weight);
+
+		class Raptor;
+
 		class TransportRouter {
 		public:
+			static constexpr EdgeId NO_WAIT_EDGE = std::numeric_limits<EdgeId>::max();
+
+			enum class RouterType {
+				ALL_PAIRS,// all routes are precomputed while the base is made
+				ON_DEMAND,// every route is searched at query time
+				CONTRACTION_HIERARCHY,// the graph is contracted while the base is made
+				RAPTOR,// routes are searched by rounds over stops of buses, the graph isn't built
+				HUB_LABELS,// labels of the contracted graph are computed while the base is made, a route is a merge of two labels
+				CUSTOMIZABLE_CONTRACTION_HIERARCHY// the order of vertices depends on the graph structure only and survives changes of weights
+			};
+
+			enum class GraphModel {
+				STOP_PAIRS,// an edge for every pair of stops of a bus, O(k^2) edges per bus
+				RIDE_VERTICES,// a vertex for every stop of a bus with boarding, riding and alighting edges, O(k) edges per bus
+				STOP_VERTICES// as STOP_PAIRS with one vertex per stop, the wait is folded into the weights of bus edges
+			};
 
 			struct RoutingSettings {
 				size_t bus_wait_time;// minutes
 				double bus_velocity;// km/h
+				RouterType router_type = RouterType::ALL_PAIRS;
+				bool bidirectional_search = false;// used by RouterType::ON_DEMAND
+				size_t thread_count = 0;// threads for precomputation, 0 - all hardware threads
+				GraphModel graph_model = GraphModel::STOP_PAIRS;
+				std::vector<std::string> closed_stops;// buses pass these stops without boarding and alighting
 			};
 
 			struct DataEdge {
@@ -34,6 +80,14 @@ namespace transport_directory {
 				int spun_count = 0;
 			};
 
+			// Overrides of the routing settings for one request, answered by Raptor over the road distances
+			struct RoutingProfile {
+				std::optional<size_t> bus_wait_time;// minutes
+				std::optional<double> bus_velocity;// km/h
+				std::unordered_map<std::string, double> bus_speed_factors;// by names of buses, multiply the velocity of the bus
+				std::optional<size_t> max_transfers;
+			};
+
 			struct RouteInfo {
 				Weight weight{};
 				std::vector<DataEdge> edges;
@@ -42,39 +96,139 @@ namespace transport_directory {
 			struct DownloadedData {
 				std::unique_ptr<Graph> graph;
 				graph::Router<Weight>::RoutesInternalData data_of_router;
-				std::unordered_map<const domain::Stop*, EdgeId> stop_id;
-				std::unordered_map<EdgeId, TransportRouter::DataEdge> edge_id_data;
+				graph::ContractionHierarchy<Weight>::HierarchyData hierarchy;// also used by RouterType::HUB_LABELS
+				graph::HubLabels<Weight>::LabelsData hub_labels;
+				std::vector<size_t> ranks;// order of vertices of RouterType::CUSTOMIZABLE_CONTRACTION_HIERARCHY
+				std::vector<EdgeId> stop_wait_edges;
+				std::vector<TransportRouter::DataEdge> edge_data;
 			};
 
 			TransportRouter(const transport_catalogue::TransportCatalogue& guide, RoutingSettings routing_settings);
 
-			TransportRouter(const transport_catalogue::TransportCatalogue& guide, RoutingSettings routing_settings, const DownloadedData& data_for_router);
+			// The graph and the data of the router are moved into the router, not copied
+			TransportRouter(const transport_catalogue::TransportCatalogue& guide, RoutingSettings routing_settings, DownloadedData&& data_for_router);
+
+			// Router for the updated catalogue: stops and buses are matched with the previous router by names,
+			// and the routes of RouterType::ALL_PAIRS are recomputed only where the changes affect them.
+			// RouterType::CUSTOMIZABLE_CONTRACTION_HIERARCHY keeps its order of vertices if the graph structure is the same
+			TransportRouter(const transport_catalogue::TransportCatalogue& guide, RoutingSettings routing_settings, const TransportRouter& previous);
+
+			~TransportRouter();
 
 			std::optional<RouteInfo> BuildRoute(std::string_view from, std::string_view to) const;
 
-			DownloadedData GetDataForTransRouter() const;
+			std::optional<RouteInfo> BuildRoute(const domain::Stop* from, const domain::Stop* to) const;
+
+			// Routes of a profile are searched by Raptor whatever the router type is, nothing is precomputed for them
+			std::optional<RouteInfo> BuildRoute(std::string_view from, std::string_view to, const RoutingProfile& profile) const;
+
+			std::optional<RouteInfo> BuildRoute(const domain::Stop* from, const domain::Stop* to, const RoutingProfile& profile) const;
+
+			// Total times of routes from every stop of from to every stop of to, row by row;
+			// nullopt, if there is no route or the stop is unknown
+			std::vector<std::vector<std::optional<Weight>>> ComputeRouteMatrix(const std::vector<const domain::Stop*>& from,
+				const std::vector<const domain::Stop*>& to) const;
 
-			const std::unordered_map<const domain::Stop*, EdgeId>& GetStopId() const;
-			const std::unordered_map<EdgeId, DataEdge>& GetEdgeIdData() const;
+			// Road distances from the first stop of the route to every stop of it
+			static std::vector<int64_t> ComputeRouteDistances(const transport_catalogue::TransportCatalogue& guide,
+				domain::RouteStops route);
+
+			// Time of riding the length in meters
+			static Weight ComputeWeightForDistance(int64_t length, double bus_velocity);
+
+			// Moves the graph and the data of the router out to be saved; the router may only be destroyed afterwards
+			DownloadedData ReleaseDataForTransRouter();
+
+			// Wait edges by ids of stops, NO_WAIT_EDGE for stops without buses
+			const std::vector<EdgeId>& GetStopWaitEdges() const;
+			// Items of routes by ids of edges
+			const std::vector<DataEdge>& GetEdgeData() const;
+			// Parallel bus edges dropped while the graph was built: an edge is dropped if another edge between
+			// the same vertices is lighter or as light with fewer stops passed. Routers loaded from a base report 0
+			size_t GetPrunedEdgeCount() const;
 			const Graph& GetGraph() const;
-			const graph::Router<Weight>& GetRouter() const;
+			const graph::RouterEngine<Weight>& GetRouter() const;
 
 		private:
 
-			Weight ComputeWeightForRoute(ranges::Range<std::vector<const domain::Stop*>::const_iterator> route) const;
+			// Edges of one bus collected before they are added to the graph
+			struct BusEdges {
+				std::vector<Edge> edges;
+				std::vector<DataEdge> data;
+			};
+
+			static constexpr size_t BUS_BATCH_SIZE = 256;
+			static constexpr Weight CLOSED_EDGE_WEIGHT = std::numeric_limits<Weight>::has_infinity
+				? std::numeric_limits<Weight>::infinity() : std::numeric_limits<Weight>::max();
+			static constexpr VertexId NO_STOP_VERTEX = std::numeric_limits<VertexId>::max();
+
+			void CreateRouter();
+
+			// Pool of routing_settings_.thread_count threads created on the first use and shared by the building
+			// of the graph and route matrices; a pool runs one job at a time, so thread_pool_mutex_ is held while it's used
+			parallel::ThreadPool& GetThreadPool() const;
+
+			void FindClosedStops();
+
+			// Edges boarding or alighting at closed stops are kept with CLOSED_EDGE_WEIGHT by RouterType::CUSTOMIZABLE_CONTRACTION_HIERARCHY,
+			// so closing a stop doesn't change the graph structure, and aren't added to the graph by other routers
+			bool KeepsClosedEdges() const;
+
+			// The same vertices and the same ends of edges as the previous graph has
+			bool HasSameStructure(const TransportRouter& previous) const;
+
+			// Graph of the routing settings, an empty one for RouterType::RAPTOR
+			void BuildGraph();
+
+			std::optional<VertexId> GetStopVertex(const domain::Stop* stop) const;
+
+			// Vertices of the beginnings of waiting, routes are searched between them only,
+			// so RouterType::ALL_PAIRS keeps rows of these vertices
+			std::vector<VertexId> GetStopVertices() const;
+
+			// Vertices of stops with buses go first in the order of stops in the catalogue,
+			// two per stop or one for GraphModel::STOP_VERTICES, so they aren't stored in the base;
+			// ride vertices of GraphModel::RIDE_VERTICES follow them in the order of buses
+			void IndexStopVertices();
+
+			// Weight of riding the bus from position board to position alight of its route, computed from
+			// the road distance at once as the direct edge of GraphModel::STOP_PAIRS is
+			Weight ComputeRideWeight(const domain::BusRoute& bus_route, size_t board, size_t alight) const;
+
+			// Ids of edges of every bus in the order they were added to the graph
+			std::unordered_map<std::string_view, std::vector<EdgeId>> GetBusEdgeIds() const;
+
+			// Maps ids of vertices and edges of the previous graph to ids of the graph;
+			// vertices and edges that are removed or changed are mapped to NO_VERTEX and NO_EDGE of graph::Router
+			void MapPreviousGraph(const TransportRouter& previous, std::vector<VertexId>& vertex_map, std::vector<EdgeId>& edge_map) const;
 
 			void ConstructGraphAndFillGraphByStops();
 
 			void FillGraphByBusRoutes();
 
-			void AddBusRouteToGraph(const domain::BusRoute& bus_route);
+			// Keeps one edge between every pair of vertices in the order of the first of them, returns the number of dropped edges
+			size_t PruneDominatedEdges(BusEdges& bus_edges) const;
+
+			// Edges of GraphModel::STOP_PAIRS and GraphModel::STOP_VERTICES
+			void CollectBusRouteEdges(const domain::BusRoute& bus_route, BusEdges& bus_edges) const;
+
+			// Edges of GraphModel::RIDE_VERTICES, ride vertices of the bus start from first_vertex
+			void CollectBusRideEdges(const domain::BusRoute& bus_route, VertexId first_vertex, BusEdges& bus_edges) const;
 
 			const transport_catalogue::TransportCatalogue& guide_;
 			RoutingSettings routing_settings_;
-			std::unordered_map<const domain::Stop*, EdgeId> stop_id_;
-			std::unordered_map<EdgeId, DataEdge> edge_id_data_;
+			std::vector<EdgeId> stop_wait_edges_;// by ids of stops
+			std::vector<VertexId> stop_vertices_;// by ids of stops, NO_STOP_VERTEX for stops without buses
+			std::vector<const domain::Stop*> vertex_stops_;// stops with buses in the order of their vertices
+			std::vector<VertexId> first_ride_vertices_;// by ids of buses, GraphModel::RIDE_VERTICES only
+			std::vector<DataEdge> edge_data_;// by ids of edges
+			std::vector<char> is_closed_;// by ids of stops
 			std::unique_ptr<Graph> graph_;
-			std::unique_ptr<graph::Router<Weight>> router_;
+			size_t pruned_edge_count_ = 0;
+			std::unique_ptr<graph::RouterEngine<Weight>> router_;// nullptr for RouterType::RAPTOR
+			std::unique_ptr<Raptor> raptor_;
+			mutable std::mutex thread_pool_mutex_;
+			mutable std::unique_ptr<parallel::ThreadPool> thread_pool_;
 		};
 
 	}// namespace transport_router